@@ -30,6 +30,18 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define CONFIG_FILENAME    "config.json"
 #define SAVE_FILENAME      "game.json"
 
+#define NETPLAY_MAGIC              "WCNP"
+#define NETPLAY_ROLLBACK_FRAMES    8
+#define NETPLAY_HISTORY            128
+#define NETPLAY_MAX_INPUTS         64
+#define LOOPBACK_PACKETS           64
+
+#define REPLAY_MAGIC      "WCRP"
+#define REPLAY_VERSION    1
+
+#define COMPILED_ENTITIES_MAGIC      "WCEN"
+#define COMPILED_ENTITIES_VERSION    1
+
 #define FPS   60
 
 #define MAX_TILES    255
@@ -42,17 +54,68 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define MAP_RENDER_WIDTH    27
 #define MAP_RENDER_HEIGHT   15
 
+#define MAP_CHUNK_WIDTH     8
+#define MAP_CHUNK_HEIGHT    15
+#define MAP_CHUNKS_X        ((MAP_WIDTH + MAP_CHUNK_WIDTH - 1) / MAP_CHUNK_WIDTH)
+#define MAP_CHUNKS_Y        ((MAP_HEIGHT + MAP_CHUNK_HEIGHT - 1) / MAP_CHUNK_HEIGHT)
+
 #define PLAYER_MOVE_SPEED 6
 
 #define MAX_TIPS    12
 
-#define MAX_QT_CANDIDATES   128
+#define MAX_QT_CANDIDATES   256
+
+#define MAX_JOB_THREADS        16
+#define MAX_COMMAND_BUFFERS    (MAX_JOB_THREADS + 1)
+#define MAX_UPDATE_GROUPS      64
+
+#define MAX_PROJECTILES    4096
+
+#define SPRITE_BATCH_SIZE    2048
+
+#define MAX_ANIM_FRAMES    8
+
+#define RECORDING_CHUNK_RUNS      128
+#define RECORDING_BLOCK_FRAMES    64
+
+#define REWIND_FRAMES               (FPS * 45)
+#define REWIND_KEYFRAME_INTERVAL    30
+#define REWIND_BUFFER_SIZE          (16 * 1024 * 1024)
+
+#define FAST_FORWARD_MAX_TICKS    8
+#define FAST_FORWARD_BUDGET       10
+
+#define PREDICTION_FRAMES      (FPS * 5)
+#define PREDICTION_INTERVAL    15
+#define PREDICTION_STEP        4
+#define PREDICTION_BUDGET      4
+#define MAX_PREDICTION_TRAILS  16
+
+#define SOLVER_STEP            6
+#define SOLVER_BEAM            256
+#define SOLVER_MAX_NODES       200000
+#define SOLVER_CLONE_POINTS    4
+#define SOLVER_TILE_STATES     4
+#define SOLVER_CELL            4
+
+#define ENV_MAX_ENTITIES       128
+#define ENV_ENTITY_FEATURES    8
+#define ENV_PICKUP_REWARD      0.1
+#define ENV_BENCHMARK_ENVS     16
+
+#define BENCHMARK_MIN_ENTS     256
+
+#define LINT_TOUCH_SIZE        16
+#define LINT_MAX_FRAMES        90
+#define LINT_GROUND_CELL       12
+#define LINT_PLATFORM_STEP     12
 
 #define MAX_NAME_LENGTH           32
 #define MAX_DESCRIPTION_LENGTH    256
 #define MAX_LINE_LENGTH           1024
 #define MAX_FILENAME_LENGTH       256
 #define MAX_PATH_LENGTH           4096
+#define MAX_ENTITY_FIELDS         16
 
 #define MAX_KEYBOARD_KEYS   350
 #define MAX_MOUSE_BUTTONS   6
@@ -70,6 +133,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define EF_NO_ENT_CLIP     (2 << 7)
 #define EF_INVISIBLE       (2 << 8)
 #define EF_STATIC          (2 << 9)
+#define EF_SERIAL_TICK     (2 << 10)
 
 enum
 {
@@ -78,11 +142,43 @@ enum
 	ET_TOILET,
 	ET_ITEM,
 	ET_STRUCTURE,
-	ET_BULLET,
 	ET_TRAP,
 	ET_SWITCH,
 	ET_VOMIT_TOILET,
-	ET_DECORATION
+	ET_DECORATION,
+	ET_PARTNER,
+	ET_MAX
+};
+
+enum
+{
+	FT_INT,
+	FT_FLOAT,
+	FT_STRING,
+	FT_FLAG,
+	FT_FACING
+};
+
+enum
+{
+	PS_ACTIVE,
+	PS_FROZEN,
+	PS_FLUSHED
+};
+
+enum
+{
+	CP_WALTER,
+	CP_TOILET,
+	CP_SPITTER,
+	CP_ITEM,
+	CP_PLATFORM,
+	CP_TRAFFIC_LIGHT,
+	CP_DECORATION,
+	CP_DOOR,
+	CP_WATER_BUTTON,
+	CP_PRESSURE_PLATE,
+	CP_MAX
 };
 
 enum
@@ -120,6 +216,22 @@ enum
 	FACING_RIGHT
 };
 
+enum
+{
+	TL_NONE,
+	TL_DECORATION,
+	TL_HAZARD,
+	TL_MAX
+};
+
+enum
+{
+	PT_WATER,
+	PT_SPIT,
+	PT_SLIME,
+	PT_MAX
+};
+
 enum
 {
 	SND_JUMP,
@@ -195,6 +307,8 @@ enum
 	CONTROL_USE,
 	CONTROL_CLONE,
 	CONTROL_RESTART,
+	CONTROL_REWIND,
+	CONTROL_FAST_FORWARD,
 	CONTROL_PAUSE,
 	CONTROL_MAX
 };
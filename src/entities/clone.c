@@ -22,11 +22,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "clone.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
-#include "../entities/player.h"
 #include "../system/sound.h"
 #include "../world/entityFactory.h"
+#include "../world/entityPool.h"
+#include "../world/projectiles.h"
+#include "../world/recording.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Game game;
 extern Stage stage;
 
@@ -34,47 +36,59 @@ static AtlasImage *normalTexture;
 static AtlasImage *shieldTexture;
 static AtlasImage *plungerTexture;
 static AtlasImage *waterPistolTexture;
+static Entity prototype;
 
 static void tick(void);
 static void die(void);
 
-void initClone(void)
+static EntityDef def = {
+	.typeName = "clone",
+	.type = ET_CLONE,
+	.tick = tick,
+	.die = die
+};
+
+/* clones are spawned whenever the player makes one, so their images are only looked up once */
+void initClonePrototype(void)
 {
-	Entity *e;
-	Walter *c;
+	prototype.def = &def;
+	prototype.atlasImage = getAtlasImage("gfx/entities/clone.png", 1);
+	prototype.w = prototype.atlasImage->rect.w;
+	prototype.h = prototype.atlasImage->rect.h;
+	prototype.flags = EF_PUSH+EF_PUSHABLE+EF_SLOW_PUSH;
 
-	c = malloc(sizeof(Walter));
-	memset(c, 0, sizeof(Walter));
+	normalTexture = prototype.atlasImage;
 
-	c->dataHead = stage.cloneDataHead.next;
+	shieldTexture = getAtlasImage("gfx/entities/cloneShield.png", 1);
 
-	stage.cloneDataHead.next = NULL;
+	plungerTexture = getAtlasImage("gfx/entities/clonePlunger.png", 1);
 
-	e = spawnEntity();
+	waterPistolTexture = getAtlasImage("gfx/entities/clonePistol.png", 1);
+}
 
-	e->typeName = "clone";
-	e->type = ET_CLONE;
-	e->atlasImage = getAtlasImage("gfx/entities/clone.png", 1);
-	e->w = e->atlasImage->rect.w;
-	e->h = e->atlasImage->rect.h;
-	e->flags = EF_PUSH+EF_PUSHABLE+EF_SLOW_PUSH;
-	e->data = c;
-	e->tick = tick;
-	e->die = die;
+void initClone(void)
+{
+	Entity *e;
+	Walter *c;
 
-	normalTexture = e->atlasImage;
+	c = allocComponent(CP_WALTER);
 
-	shieldTexture = getAtlasImage("gfx/entities/cloneShield.png", 1);
+	/* the player can still add to the recording this frame; it's only played once the stage is reset */
+	c->recording = stage.recording;
+	c->recording->users++;
 
-	plungerTexture = getAtlasImage("gfx/entities/clonePlunger.png", 1);
+	e = spawnPrototype(&prototype);
 
-	waterPistolTexture = getAtlasImage("gfx/entities/clonePistol.png", 1);
+	e->data = c;
+
+	addEntity(e);
 
 	game.stats[STAT_CLONES]++;
 }
 
 static void tick(void)
 {
+	RecordedFrame frame;
 	Walter *c;
 
 	c = (Walter*)self->data;
@@ -103,71 +117,53 @@ static void tick(void)
 	self->w = self->atlasImage->rect.w;
 	self->h = self->atlasImage->rect.h;
 
-	if (c->advanceData)
-	{
-		c->advanceData = 0;
-
-		if (c->pData == NULL)
-		{
-			c->pData = c->dataHead;
-		}
-		else
-		{
-			c->pData = c->pData->next;
-		}
-	}
-
-	if (isValidCloneFrame(c))
+	if (c->playing && getRecordedFrame(c->recording, stage.frame, &frame))
 	{
-		memcpy(&c->data, c->pData, sizeof(CloneData));
-
-		self->dx = c->data.dx;
-		self->dy = c->data.dy;
+		self->dx = frame.dx;
+		self->dy = frame.dy;
 
-		if (c->data.dx < 0)
+		if (frame.dx < 0)
 		{
 			self->facing = FACING_LEFT;
 		}
 
-		if (c->data.dx > 0)
+		if (frame.dx > 0)
 		{
 			self->facing = FACING_RIGHT;
 		}
 
-		if (c->data.dy < 0 && self->isOnGround)
+		if (frame.dy < 0 && self->isOnGround)
 		{
-			self->riding = NULL;
+			self->riding = getEntityHandle(NULL);
 
-			playPositionalSound(SND_JUMP, CH_CLONE, self->x, self->y, stage.player->x, stage.player->y);
+			playPositionalSound(SND_JUMP, CH_CLONE, self->x, self->y, getPlayer()->x, getPlayer()->y);
 		}
 
-		c->action = c->data.action;
+		c->action = frame.action;
 
 		if (c->action)
 		{
 			if (c->equipment == EQ_WATER_PISTOL)
 			{
 				/* done in player.c */
-				fireWaterPistol();
+				fireProjectile(PT_WATER, self);
 
-				playPositionalSound(SND_SQUIRT, CH_SHOOT, self->x, self->y, stage.player->x, stage.player->y);
+				playPositionalSound(SND_SQUIRT, CH_SHOOT, self->x, self->y, getPlayer()->x, getPlayer()->y);
 			}
 		}
-
-		c->advanceData = 1;
 	}
 }
 
 int isValidCloneFrame(Walter *c)
 {
-	return c->pData != NULL && c->pData->frame == stage.frame;
+	return c->playing && getRecordedFrame(c->recording, stage.frame, NULL);
 }
 
 static void die(void)
 {
 	addDeathParticles(self->x, self->y);
 
-	playPositionalSound(SND_DEATH, CH_CLONE, self->x, self->y, stage.player->x, stage.player->y);
+	playPositionalSound(SND_DEATH, CH_CLONE, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 	game.stats[STAT_CLONE_DEATHS]++;
 }
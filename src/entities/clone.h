@@ -20,3 +20,4 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 int isValidCloneFrame(Walter *c);
 void initClone(void);
+void initClonePrototype(void);
@@ -20,69 +20,62 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "coin.h"
+#include "../system/animation.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Game game;
 extern Stage stage;
 
-static void tick(void);
 static void touch(Entity *other);
 static void die(void);
 
-void initCoin(Entity *e)
-{
-	Collectable *c;
-
-	c = malloc(sizeof(Collectable));
-	memset(c, 0, sizeof(Collectable));
+static AnimClip bobClip = {.bob = 2.5};
 
-	c->bobValue = rand() % 10;
+static EntityDef def = {
+	.typeName = "coin",
+	.type = ET_ITEM,
+	.touch = touch,
+	.die = die
+};
 
-	e->typeName = "coin";
-	e->type = ET_ITEM;
-	e->data = c;
+void initCoinPrototype(Entity *e)
+{
+	e->def = &def;
 	e->atlasImage = getAtlasImage("gfx/entities/coin.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_WEIGHTLESS+EF_NO_ENT_CLIP+EF_STATIC;
-	e->tick = tick;
-	e->touch = touch;
-	e->die = die;
+	e->anim = &bobClip;
 
 	e->light.r = 255;
 	e->light.g = 255;
 	e->light.a = 64;
-
-	stage.totalCoins++;
 }
 
-static void tick(void)
+void initCoin(Entity *e)
 {
-	Collectable *c;
-
-	c = (Collectable*)self->data;
+	initBobPhase(e);
 
-	c->bobValue += 0.1;
-
-	self->y += sin(c->bobValue) * 0.25;
+	stage.totalCoins++;
 }
 
 static void touch(Entity *other)
 {
-	if (self->health > 0 && other != NULL && (other->type == ET_PLAYER || other->type == ET_CLONE))
+	if (self->health > 0 && other != NULL && isWalter(other))
 	{
 		self->health = 0;
 
-		playPositionalSound(SND_COIN, CH_COIN, self->x, self->y, stage.player->x, stage.player->y);
+		playPositionalSound(SND_COIN, CH_COIN, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 		stage.coins++;
 
 		if (stage.items == stage.totalItems && stage.coins == stage.totalCoins)
 		{
-			playPositionalSound(SND_FANFARE, CH_COIN, self->x, self->y, stage.player->x, stage.player->y);
+			playPositionalSound(SND_FANFARE, CH_COIN, self->x, self->y, getPlayer()->x, getPlayer()->y);
 		}
 
 		game.stats[STAT_COINS]++;
@@ -20,55 +20,54 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "decoration.h"
-#include "../json/cJSON.h"
 #include "../system/atlas.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 
-static void load(cJSON *root);
-static void save(cJSON *root);
+static void load(void);
 
-void initDecoration(Entity *e)
-{
-	Decoration *d;
+static EntityField fields[] = {
+	{"textureFilename", FT_STRING, offsetof(Decoration, textureFilename)}
+};
 
-	d = malloc(sizeof(Decoration));
-	memset(d, 0, sizeof(Decoration));
-
-	STRNCPY(d->textureFilename, "gfx/decoration/cabinet.png", MAX_NAME_LENGTH);
+static EntityDef def = {
+	.typeName = "decoration",
+	.type = ET_DECORATION,
+	.tileLayer = TL_DECORATION,
+	.load = load,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
 
-	e->typeName = "decoration";
-	e->type = ET_DECORATION;
-	e->data = d;
+void initDecorationPrototype(Entity *e)
+{
+	e->def = &def;
 	e->facing = 1;
-	e->atlasImage = getAtlasImage(d->textureFilename, 1);
+	e->atlasImage = getAtlasImage("gfx/decoration/cabinet.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_WEIGHTLESS+EF_NO_ENT_CLIP+EF_STATIC;
-
-	e->load = load;
-	e->save = save;
 }
 
-static void load(cJSON *root)
+void initDecoration(Entity *e)
 {
 	Decoration *d;
 
-	d = (Decoration*)self->data;
+	d = allocComponent(CP_DECORATION);
 
-	STRNCPY(d->textureFilename, cJSON_GetObjectItem(root, "textureFilename")->valuestring, MAX_NAME_LENGTH);
+	STRNCPY(d->textureFilename, "gfx/decoration/cabinet.png", MAX_NAME_LENGTH);
 
-	self->atlasImage = getAtlasImage(d->textureFilename, 1);
-	self->w = self->atlasImage->rect.w;
-	self->h = self->atlasImage->rect.h;
+	e->data = d;
 }
 
-static void save(cJSON *root)
+static void load(void)
 {
 	Decoration *d;
 
 	d = (Decoration*)self->data;
 
-	cJSON_AddStringToObject(root, "textureFilename", d->textureFilename);
+	self->atlasImage = getAtlasImage(d->textureFilename, 1);
+	self->w = self->atlasImage->rect.w;
+	self->h = self->atlasImage->rect.h;
 }
-
@@ -20,48 +20,56 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "door.h"
-#include "../json/cJSON.h"
 #include "../system/atlas.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Stage stage;
 
 static void tick(void);
 static void activate(int active);
 static void touch(Entity *other);
-static void load(cJSON *root);
-static void save(cJSON *root);
+
+static EntityField fields[] = {
+	{"open", FT_INT, offsetof(Door, open)}
+};
+
+static EntityDef def = {
+	.typeName = "door",
+	.type = ET_STRUCTURE,
+	.tick = tick,
+	.touch = touch,
+	.activate = activate,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
+
+void initDoorPrototype(Entity *e)
+{
+	e->def = &def;
+	e->atlasImage = getAtlasImage("gfx/entities/door.png", 1);
+	e->w = e->atlasImage->rect.w;
+	e->h = e->atlasImage->rect.h;
+	e->flags = EF_SOLID+EF_WEIGHTLESS+EF_PUSH+EF_NO_WORLD_CLIP;
+	e->background = 1;
+}
 
 void initDoor(Entity *e)
 {
 	Door *d;
 
-	d = malloc(sizeof(Door));
-	memset(d, 0, sizeof(Door));
+	d = allocComponent(CP_DOOR);
 
 	d->sx = e->x;
 	d->sy = e->y;
 	d->ex = e->x;
 	d->ey = e->y;
 
-	e->typeName = "door";
-	e->type = ET_STRUCTURE;
 	e->data = d;
-	e->tick = tick;
-	e->activate = activate;
-	e->touch = touch;
-	e->atlasImage = getAtlasImage("gfx/entities/door.png", 1);
-	e->w = e->atlasImage->rect.w;
-	e->h = e->atlasImage->rect.h;
-	e->flags = EF_SOLID+EF_WEIGHTLESS+EF_PUSH+EF_NO_WORLD_CLIP;
-	e->background = 1;
 
 	/* when opened */
 	d->ey = e->y - (e->h - 4);
-
-	e->load = load;
-	e->save = save;
 }
 
 static void tick(void)
@@ -105,14 +113,14 @@ static void activate(int active)
 
 	d->open = !d->open;
 
-	playPositionalSound(SND_DOOR, CH_STRUCTURE, self->x, self->y, stage.player->x, stage.player->y);
+	playPositionalSound(SND_DOOR, CH_STRUCTURE, self->x, self->y, getPlayer()->x, getPlayer()->y);
 }
 
 static void touch(Entity *other)
 {
 	Door *d;
 
-	if (other != NULL && (other->type == ET_PLAYER || other->type == ET_CLONE) && stage.keys > 0)
+	if (other != NULL && isWalter(other) && stage.keys > 0)
 	{
 		d = (Door*)self->data;
 
@@ -122,26 +130,7 @@ static void touch(Entity *other)
 			d->open = 1;
 			self->flags |= EF_NO_WORLD_CLIP;
 
-			playPositionalSound(SND_DOOR, CH_STRUCTURE, self->x, self->y, stage.player->x, stage.player->y);
+			playPositionalSound(SND_DOOR, CH_STRUCTURE, self->x, self->y, getPlayer()->x, getPlayer()->y);
 		}
 	}
 }
-
-static void load(cJSON *root)
-{
-	Door *d;
-
-	d = (Door*)self->data;
-
-	d->open = cJSON_GetObjectItem(root, "open")->valueint;
-}
-
-static void save(cJSON *root)
-{
-	Door *d;
-
-	d = (Door*)self->data;
-
-	cJSON_AddNumberToObject(root, "open", d->open);
-}
-
@@ -22,32 +22,40 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "finalToilet.h"
 #include "../json/cJSON.h"
 #include "../system/atlas.h"
+#include "../world/entityPool.h"
 
 extern Stage stage;
 
 static void touch(Entity *other);
 
-void initFinalToilet(Entity *e)
-{
-	Toilet *t;
-
-	t = malloc(sizeof(Toilet));
-	memset(t, 0, sizeof(Toilet));
+static EntityDef def = {
+	.typeName = "finalToilet",
+	.type = ET_TOILET,
+	.touch = touch
+};
 
-	e->typeName = "finalToilet";
+void initFinalToiletPrototype(Entity *e)
+{
+	e->def = &def;
 	e->facing = 0;
-	e->type = ET_TOILET;
-	e->data = t;
 	e->atlasImage = getAtlasImage("gfx/entities/toilet.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_NO_ENT_CLIP+EF_STATIC;
-	e->touch = touch;
+}
+
+void initFinalToilet(Entity *e)
+{
+	Toilet *t;
+
+	t = allocComponent(CP_TOILET);
+
+	e->data = t;
 }
 
 static void touch(Entity *other)
 {
-	if (other != NULL && other->type == ET_PLAYER)
+	if (other != NULL && other->def->type == ET_PLAYER)
 	{
 		stage.status = SS_GAME_COMPLETE;
 	}
@@ -20,77 +20,78 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "item.h"
-#include "../json/cJSON.h"
+#include "../system/animation.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Game game;
 extern Stage stage;
 
-static void tick(void);
 static void touch(Entity *other);
 static void die(void);
-static void load(cJSON *root);
-static void save(cJSON *root);
+static void load(void);
 
-void initItem(Entity *e)
-{
-	Item *i;
+static AnimClip bobClip = {.bob = 5};
 
-	i = malloc(sizeof(Item));
-	memset(i, 0, sizeof(Item));
+static EntityField fields[] = {
+	{"textureFilename", FT_STRING, offsetof(Item, textureFilename)}
+};
 
-	STRNCPY(i->textureFilename, "gfx/entities/item01.png", MAX_NAME_LENGTH);
+static EntityDef def = {
+	.typeName = "item",
+	.type = ET_ITEM,
+	.touch = touch,
+	.die = die,
+	.load = load,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
 
-	i->bobValue = rand() % 10;
-
-	e->typeName = "item";
-	e->type = ET_ITEM;
-	e->data = i;
-	e->atlasImage = getAtlasImage(i->textureFilename, 1);
+void initItemPrototype(Entity *e)
+{
+	e->def = &def;
+	e->atlasImage = getAtlasImage("gfx/entities/item01.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_WEIGHTLESS+EF_NO_ENT_CLIP+EF_STATIC;
-	e->tick = tick;
-	e->touch = touch;
-	e->die = die;
-
-	e->load = load;
-	e->save = save;
+	e->anim = &bobClip;
 
 	e->light.r = 255;
 	e->light.b = 255;
 	e->light.a = 64;
-
-	stage.totalItems++;
 }
 
-static void tick(void)
+void initItem(Entity *e)
 {
 	Item *i;
 
-	i = (Item*)self->data;
+	i = allocComponent(CP_ITEM);
+
+	STRNCPY(i->textureFilename, "gfx/entities/item01.png", MAX_NAME_LENGTH);
 
-	i->bobValue += 0.1;
+	initBobPhase(e);
 
-	self->y += sin(i->bobValue) * 0.5;
+	e->data = i;
+
+	stage.totalItems++;
 }
 
 static void touch(Entity *other)
 {
-	if (self->health > 0 && other != NULL && (other->type == ET_PLAYER || other->type == ET_CLONE))
+	if (self->health > 0 && other != NULL && isWalter(other))
 	{
 		self->health = 0;
 
-		playPositionalSound(SND_ITEM, CH_ITEM, self->x, self->y, stage.player->x, stage.player->y);
+		playPositionalSound(SND_ITEM, CH_ITEM, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 		stage.items++;
 
 		if (stage.items == stage.totalItems && stage.coins == stage.totalCoins)
 		{
-			playPositionalSound(SND_FANFARE, CH_ITEM, self->x, self->y, stage.player->x, stage.player->y);
+			playPositionalSound(SND_FANFARE, CH_ITEM, self->x, self->y, getPlayer()->x, getPlayer()->y);
 		}
 
 		game.stats[STAT_ITEMS]++;
@@ -102,25 +103,13 @@ static void die(void)
 	addPowerupParticles(self->x + self->w / 2, self->y + self->h / 2);
 }
 
-static void load(cJSON *root)
+static void load(void)
 {
 	Item *item;
 
 	item = (Item*)self->data;
 
-	STRNCPY(item->textureFilename, cJSON_GetObjectItem(root, "textureFilename")->valuestring, MAX_NAME_LENGTH);
-
 	self->atlasImage = getAtlasImage(item->textureFilename, 1);
 	self->w = self->atlasImage->rect.w;
 	self->h = self->atlasImage->rect.h;
 }
-
-static void save(cJSON *root)
-{
-	Item *item;
-
-	item = (Item*)self->data;
-
-	cJSON_AddStringToObject(root, "textureFilename", item->textureFilename);
-}
-
@@ -20,61 +20,54 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "key.h"
+#include "../system/animation.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Game game;
 extern Stage stage;
 
-static void tick(void);
 static void touch(Entity *other);
 
-void initKey(Entity *e)
-{
-	Collectable *k;
-
-	k = malloc(sizeof(Collectable));
-	memset(k, 0, sizeof(Collectable));
+static AnimClip bobClip = {.bob = 5};
 
-	k->bobValue = rand() % 10;
+static EntityDef def = {
+	.typeName = "key",
+	.type = ET_ITEM,
+	.touch = touch
+};
 
-	e->typeName = "key";
-	e->type = ET_ITEM;
-	e->data = k;
+void initKeyPrototype(Entity *e)
+{
+	e->def = &def;
 	e->atlasImage = getAtlasImage("gfx/entities/key.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_WEIGHTLESS+EF_NO_ENT_CLIP+EF_STATIC;
-	e->tick = tick;
-	e->touch = touch;
+	e->anim = &bobClip;
 
 	e->light.r = 255;
 	e->light.g = 128;
 	e->light.a = 64;
-
-	stage.totalKeys++;
 }
 
-static void tick(void)
+void initKey(Entity *e)
 {
-	Collectable *k;
-
-	k = (Collectable*)self->data;
+	initBobPhase(e);
 
-	k->bobValue += 0.1;
-
-	self->y += sin(k->bobValue) * 0.5;
+	stage.totalKeys++;
 }
 
 static void touch(Entity *other)
 {
-	if (self->health > 0 && other != NULL && (other->type == ET_PLAYER || other->type == ET_CLONE))
+	if (self->health > 0 && other != NULL && isWalter(other))
 	{
 		self->health = 0;
 
-		playPositionalSound(SND_KEY, CH_ITEM, self->x, self->y, stage.player->x, stage.player->y);
+		playPositionalSound(SND_KEY, CH_ITEM, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 		addPowerupParticles(self->x + self->w / 2, self->y + self->h / 2);
 
@@ -20,58 +20,51 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "manholeCover.h"
+#include "../system/animation.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Game game;
 extern Stage stage;
 
-static void tick(void);
 static void touch(Entity *other);
 static void die(void);
 
-void initManholeCover(Entity *e)
-{
-	Collectable *m;
+static AnimClip bobClip = {.bob = 5};
 
-	m = malloc(sizeof(Collectable));
-	memset(m, 0, sizeof(Collectable));
+static EntityDef def = {
+	.typeName = "manholeCover",
+	.type = ET_ITEM,
+	.touch = touch,
+	.die = die
+};
 
-	m->bobValue = rand() % 10;
-
-	e->typeName = "manholeCover";
-	e->type = ET_ITEM;
-	e->data = m;
+void initManholeCoverPrototype(Entity *e)
+{
+	e->def = &def;
 	e->atlasImage = getAtlasImage("gfx/entities/manholeCover.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_WEIGHTLESS+EF_NO_ENT_CLIP+EF_STATIC;
-	e->tick = tick;
-	e->touch = touch;
-	e->die = die;
+	e->anim = &bobClip;
 
 	e->light.r = e->light.g = e->light.b = 255;
 	e->light.a = 64;
 }
 
-static void tick(void)
+void initManholeCover(Entity *e)
 {
-	Collectable *m;
-
-	m = (Collectable*)self->data;
-
-	m->bobValue += 0.1;
-
-	self->y += sin(m->bobValue) * 0.5;
+	initBobPhase(e);
 }
 
 static void touch(Entity *other)
 {
 	Walter *w;
 
-	if (self->health > 0 && other != NULL && (other->type == ET_PLAYER || other->type == ET_CLONE))
+	if (self->health > 0 && other != NULL && isWalter(other))
 	{
 		w = (Walter*)other->data;
 
@@ -81,7 +74,7 @@ static void touch(Entity *other)
 
 			w->equipment = EQ_MANHOLE_COVER;
 
-			playPositionalSound(SND_MANHOLE_COVER, CH_ITEM, self->x, self->y, stage.player->x, stage.player->y);
+			playPositionalSound(SND_MANHOLE_COVER, CH_ITEM, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 			game.stats[STAT_MANHOLE_COVERS]++;
 		}
@@ -0,0 +1,94 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "partner.h"
+#include "../system/atlas.h"
+#include "../entities/player.h"
+#include "../world/particles.h"
+#include "../system/sound.h"
+#include "../world/entityFactory.h"
+#include "../world/entityPool.h"
+
+extern _Thread_local Entity *self;
+extern Stage stage;
+
+static Entity prototype;
+
+static void tick(void);
+static void die(void);
+
+static EntityDef def = {
+	.typeName = "partner",
+	.type = ET_PARTNER,
+	.tick = tick,
+	.die = die
+};
+
+/* the second Walter in co-op, who is spawned alongside the player rather than placed */
+void initPartnerPrototype(void)
+{
+	prototype.def = &def;
+	prototype.atlasImage = getAtlasImage("gfx/entities/guy.png", 1);
+	prototype.w = prototype.atlasImage->rect.w;
+	prototype.h = prototype.atlasImage->rect.h;
+	prototype.flags = EF_PUSH+EF_PUSHABLE+EF_SLOW_PUSH+EF_SERIAL_TICK;
+}
+
+void initPartner(void)
+{
+	Entity *e, *player;
+
+	player = getPlayer();
+
+	e = spawnPrototype(&prototype);
+
+	e->x = player->x + player->w;
+	e->y = player->y;
+	e->facing = player->facing;
+
+	e->data = allocComponent(CP_WALTER);
+
+	addEntity(e);
+
+	stage.partner = getEntityHandle(e);
+}
+
+/* moves like the player, but on stage.partnerControls, and without being recorded for clones */
+static void tick(void)
+{
+	if (moveWalter(stage.partnerControls) & (1 << CONTROL_JUMP))
+	{
+		playPositionalSound(SND_JUMP, CH_CLONE, self->x, self->y, getPlayer()->x, getPlayer()->y);
+	}
+}
+
+static void die(void)
+{
+	/* flushed away, so just removed */
+	if (self->state == PS_FLUSHED)
+	{
+		return;
+	}
+
+	addDeathParticles(self->x, self->y);
+
+	playPositionalSound(SND_DEATH, CH_CLONE, self->x, self->y, getPlayer()->x, getPlayer()->y);
+}
@@ -20,23 +20,50 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "platform.h"
-#include "../json/cJSON.h"
 #include "../system/atlas.h"
 #include "../system/util.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 
 static void tick(void);
 static void activate(int active);
-static void load(cJSON *root);
-static void save(cJSON *root);
+static void load(void);
+
+static EntityField fields[] = {
+	{"sx", FT_FLOAT, offsetof(Platform, sx)},
+	{"sy", FT_FLOAT, offsetof(Platform, sy)},
+	{"ex", FT_FLOAT, offsetof(Platform, ex)},
+	{"ey", FT_FLOAT, offsetof(Platform, ey)},
+	{"pause", FT_INT, offsetof(Platform, pause)},
+	{"speed", FT_INT, offsetof(Platform, speed)},
+	{"enabled", FT_INT, offsetof(Platform, enabled)}
+};
+
+static EntityDef def = {
+	.typeName = "platform",
+	.type = ET_STRUCTURE,
+	.tick = tick,
+	.activate = activate,
+	.load = load,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
+
+void initPlatformPrototype(Entity *e)
+{
+	e->def = &def;
+	e->atlasImage = getAtlasImage("gfx/entities/platform.png", 1);
+	e->w = e->atlasImage->rect.w;
+	e->h = e->atlasImage->rect.h;
+	e->flags = EF_SOLID+EF_WEIGHTLESS+EF_PUSH;
+}
 
 void initPlatform(Entity *e)
 {
 	Platform *p;
 
-	p = malloc(sizeof(Platform));
-	memset(p, 0, sizeof(Platform));
+	p = allocComponent(CP_PLATFORM);
 
 	/* defaults */
 	p->sx = e->x;
@@ -46,18 +73,7 @@ void initPlatform(Entity *e)
 	p->pause = FPS;
 	p->speed = 2;
 
-	e->typeName = "platform";
-	e->type = ET_STRUCTURE;
 	e->data = p;
-	e->tick = tick;
-	e->activate = activate;
-	e->atlasImage = getAtlasImage("gfx/entities/platform.png", 1);
-	e->w = e->atlasImage->rect.w;
-	e->h = e->atlasImage->rect.h;
-	e->flags = EF_SOLID+EF_WEIGHTLESS+EF_PUSH;
-
-	e->load = load;
-	e->save = save;
 }
 
 static void tick(void)
@@ -131,38 +147,14 @@ static void activate(int active)
 	p->enabled = !p->enabled;
 }
 
-static void load(cJSON *root)
+static void load(void)
 {
 	Platform *p;
 
 	p = (Platform*)self->data;
 
-	p->sx = cJSON_GetObjectItem(root, "sx")->valueint;
-	p->sy = cJSON_GetObjectItem(root, "sy")->valueint;
-	p->ex = cJSON_GetObjectItem(root, "ex")->valueint;
-	p->ey = cJSON_GetObjectItem(root, "ey")->valueint;
-	p->pause = cJSON_GetObjectItem(root, "pause")->valueint;
-	p->speed = cJSON_GetObjectItem(root, "speed")->valueint;
-	p->enabled = cJSON_GetObjectItem(root, "enabled")->valueint;
-
 	self->x = p->sx;
 	self->y = p->sy;
 
 	p->pauseTimer = p->pause;
 }
-
-static void save(cJSON *root)
-{
-	Platform *p;
-
-	p = (Platform*)self->data;
-
-	cJSON_AddNumberToObject(root, "sx", p->sx);
-	cJSON_AddNumberToObject(root, "sy", p->sy);
-	cJSON_AddNumberToObject(root, "ex", p->ex);
-	cJSON_AddNumberToObject(root, "ey", p->ey);
-	cJSON_AddNumberToObject(root, "pause", p->pause);
-	cJSON_AddNumberToObject(root, "speed", p->speed);
-	cJSON_AddNumberToObject(root, "enabled", p->enabled);
-}
-
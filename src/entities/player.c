@@ -20,49 +20,47 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "player.h"
-#include "../json/cJSON.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
 #include "../system/sound.h"
 #include "../world/entityFactory.h"
 #include "../system/controls.h"
+#include "../world/entityPool.h"
+#include "../world/projectiles.h"
+#include "../world/recording.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Game game;
 extern Stage stage;
 
-static void recordCloneData(void);
 static void tick(void);
 static void die(void);
-static void load(cJSON *root);
-static void save(cJSON *root);
 
 static AtlasImage *normalTexture;
 static AtlasImage *shieldTexture;
 static AtlasImage *plungerTexture;
 static AtlasImage *waterPistolTexture;
-static AtlasImage *bulletTexture;
 static float px;
 static float py;
 
-void initPlayer(Entity *e)
-{
-	Walter *p;
+static EntityField fields[] = {
+	{"facing", FT_FACING, 0}
+};
 
-	stage.player = e;
+static EntityDef def = {
+	.typeName = "player",
+	.type = ET_PLAYER,
+	.tick = tick,
+	.die = die,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
 
-	p = malloc(sizeof(Walter));
-	memset(p, 0, sizeof(Walter));
-
-	e->typeName = "player";
-	e->data = p;
-	e->type = ET_PLAYER;
+void initPlayerPrototype(Entity *e)
+{
+	e->def = &def;
 	e->atlasImage = getAtlasImage("gfx/entities/guy.png", 1);
-	e->flags = EF_PUSH+EF_PUSHABLE+EF_SLOW_PUSH;
-	e->tick = tick;
-	e->die = die;
-	e->load = load;
-	e->save = save;
+	e->flags = EF_PUSH+EF_PUSHABLE+EF_SLOW_PUSH+EF_SERIAL_TICK;
 
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
@@ -74,8 +72,17 @@ void initPlayer(Entity *e)
 	plungerTexture = getAtlasImage("gfx/entities/guyPlunger.png", 1);
 
 	waterPistolTexture = getAtlasImage("gfx/entities/guyPistol.png", 1);
+}
+
+void initPlayer(Entity *e)
+{
+	Walter *p;
+
+	stage.player = getEntityHandle(e);
 
-	bulletTexture = getAtlasImage("gfx/entities/waterBullet.png", 1);
+	p = allocComponent(CP_WALTER);
+
+	e->data = p;
 
 	px = e->x;
 	py = e->y;
@@ -84,6 +91,13 @@ void initPlayer(Entity *e)
 static void tick(void)
 {
 	Walter *p;
+	int controls, done, i;
+
+	/* on show in the title and ending */
+	if (self->state == PS_FROZEN)
+	{
+		return;
+	}
 
 	p = (Walter*)self->data;
 
@@ -100,6 +114,51 @@ static void tick(void)
 	px = self->x;
 	py = self->y;
 
+	controls = 0;
+
+	for (i = CONTROL_LEFT ; i <= CONTROL_USE ; i++)
+	{
+		if (isControl(i))
+		{
+			controls |= 1 << i;
+		}
+	}
+
+	done = moveWalter(controls);
+
+	if (done & (1 << CONTROL_JUMP))
+	{
+		playSound(SND_JUMP, CH_PLAYER);
+
+		game.stats[STAT_JUMPS]++;
+	}
+
+	if (done & (1 << CONTROL_USE))
+	{
+		clearControl(CONTROL_USE);
+
+		if (p->equipment == EQ_WATER_PISTOL)
+		{
+			game.stats[STAT_SHOTS_FIRED]++;
+		}
+	}
+
+	if (self->health > 0 && (self->dx != 0 || self->dy < 0 || p->action))
+	{
+		recordFrame(stage.frame, self->dx, self->dy, p->action);
+	}
+}
+
+/* the Walter on self, whether the player or the partner, acting on a bitmask of held controls. Returns the controls that did something, for the caller's own sounds and stats */
+int moveWalter(int controls)
+{
+	Walter *p;
+	int done;
+
+	p = (Walter*)self->data;
+
+	done = 0;
+
 	self->dx = 0;
 	p->action = 0;
 
@@ -127,74 +186,55 @@ static void tick(void)
 
 	if (self->health > 0)
 	{
-		if (isControl(CONTROL_LEFT))
+		if (controls & (1 << CONTROL_LEFT))
 		{
 			self->dx = -PLAYER_MOVE_SPEED;
 
 			self->facing = FACING_LEFT;
 		}
 
-		if (isControl(CONTROL_RIGHT))
+		if (controls & (1 << CONTROL_RIGHT))
 		{
 			self->dx = PLAYER_MOVE_SPEED;
 
 			self->facing = FACING_RIGHT;
 		}
 
-		if (isControl(CONTROL_JUMP) && self->isOnGround && p->equipment != EQ_MANHOLE_COVER)
+		if ((controls & (1 << CONTROL_JUMP)) && self->isOnGround && p->equipment != EQ_MANHOLE_COVER)
 		{
-			self->riding = NULL;
+			self->riding = getEntityHandle(NULL);
 
 			self->dy = -20;
 
-			playSound(SND_JUMP, CH_PLAYER);
-
-			game.stats[STAT_JUMPS]++;
+			done |= 1 << CONTROL_JUMP;
 		}
 
-		if (isControl(CONTROL_USE))
+		if (controls & (1 << CONTROL_USE))
 		{
-			clearControl(CONTROL_USE);
-
 			p->action = 1;
 
 			if (p->equipment == EQ_WATER_PISTOL)
 			{
-				game.stats[STAT_SHOTS_FIRED]++;
-
-				fireWaterPistol();
+				fireProjectile(PT_WATER, self);
 
-				playPositionalSound(SND_SQUIRT, CH_SHOOT, self->x, self->y, stage.player->x, stage.player->y);
+				playPositionalSound(SND_SQUIRT, CH_SHOOT, self->x, self->y, getPlayer()->x, getPlayer()->y);
 			}
-		}
 
-		if (self->dx != 0 || self->dy < 0 || p->action)
-		{
-			recordCloneData();
+			done |= 1 << CONTROL_USE;
 		}
 	}
-}
-
-static void recordCloneData(void)
-{
-	CloneData *c;
-	Walter *p;
 
-	p = (Walter*)self->data;
-
-	c = malloc(sizeof(CloneData));
-	memset(c, 0, sizeof(CloneData));
-	stage.cloneDataTail->next = c;
-	stage.cloneDataTail = c;
-
-	c->frame = stage.frame;
-	c->dx = self->dx;
-	c->dy = self->dy;
-	c->action = p->action;
+	return done;
 }
 
 static void die(void)
 {
+	/* flushed away, so just removed */
+	if (self->state == PS_FLUSHED)
+	{
+		return;
+	}
+
 	addDeathParticles(self->x, self->y);
 
 	playSound(SND_DEATH, CH_PLAYER);
@@ -210,73 +250,3 @@ static void die(void)
 
 	game.stats[STAT_DEATHS]++;
 }
-
-static void load(cJSON *root)
-{
-	self->facing = strcmp(cJSON_GetObjectItem(root, "facing")->valuestring, "left") == 0 ? 0 : 1;
-}
-
-static void save(cJSON *root)
-{
-	cJSON_AddStringToObject(root, "facing", self->facing == 0 ? "left" : "right");
-}
-
-/* === Water pistol bullets === */
-
-static void bulletTouch(Entity *other)
-{
-	if (other != NULL)
-	{
-		if (other->type == ET_BULLET)
-		{
-			other->health = self->health = 0;
-
-			playPositionalSound(SND_SPIT_HIT, CH_HIT, self->x, self->y, stage.player->x, stage.player->y);
-		}
-		else if (other->flags & EF_SOLID)
-		{
-			self->health = 0;
-
-			playPositionalSound(SND_SPIT_HIT, CH_HIT, self->x, self->y, stage.player->x, stage.player->y);
-		}
-	}
-	else
-	{
-		self->health = 0;
-
-		playPositionalSound(SND_SPIT_HIT, CH_HIT, self->x, self->y, stage.player->x, stage.player->y);
-	}
-}
-
-static void bulletDie(void)
-{
-	addWaterBurstParticles(self->x, self->y);
-}
-
-void fireWaterPistol(void)
-{
-	Entity *e;
-
-	e = spawnEntity();
-
-	e->type = ET_BULLET;
-	e->typeName = "bullet";
-	e->x = self->x;
-	e->y = self->y;
-	e->facing = self->facing;
-	e->dx = self->facing ? 12 : -12;
-	e->flags = EF_WEIGHTLESS+EF_NO_MAP_BOUNDS;
-	e->atlasImage = bulletTexture;
-	e->w = e->atlasImage->rect.w;
-	e->h = e->atlasImage->rect.h;
-	e->touch = bulletTouch;
-	e->die = bulletDie;
-
-	e->y += (e->h / 2);
-
-	if (e->facing)
-	{
-		e->x += self->w;
-	}
-}
-
@@ -18,5 +18,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
-void fireWaterPistol(void);
+int moveWalter(int controls);
 void initPlayer(Entity *e);
+void initPlayerPrototype(Entity *e);
@@ -20,51 +20,62 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "pressurePlate.h"
-#include "../json/cJSON.h"
 #include "../world/entities.h"
 #include "../system/atlas.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
+#include "../world/targets.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Stage stage;
 
 static void tick(void);
-static void load(cJSON *root);
-static void save(cJSON *root);
+static void load(void);
 static void touch(Entity *other);
 
 static AtlasImage *idleTexture;
 static AtlasImage *activeTexture;
 
-void initPressurePlate(Entity *e)
+static EntityField fields[] = {
+	{"targetName", FT_STRING, offsetof(PressurePlate, targetName)}
+};
+
+static EntityDef def = {
+	.typeName = "pressurePlate",
+	.type = ET_STRUCTURE,
+	.tick = tick,
+	.touch = touch,
+	.load = load,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
+
+void initPressurePlatePrototype(Entity *e)
 {
-	PressurePlate *p;
-
 	idleTexture = getAtlasImage("gfx/entities/pressurePlateIdle.png", 1);
 	activeTexture = getAtlasImage("gfx/entities/pressurePlateActive.png", 1);
 
-	p = malloc(sizeof(PressurePlate));
-	memset(p, 0, sizeof(PressurePlate));
-
-	e->typeName = "pressurePlate";
-	e->type = ET_STRUCTURE;
-	e->data = p;
-	e->tick = tick;
-	e->touch = touch;
+	e->def = &def;
 	e->atlasImage = idleTexture;
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_SOLID+EF_WEIGHTLESS+EF_STATIC;
 
-	e->load = load;
-	e->save = save;
-
 	e->light.r = 128;
 	e->light.g = 192;
 	e->light.b = 255;
 	e->light.foreground = 1;
 }
 
+void initPressurePlate(Entity *e)
+{
+	PressurePlate *p;
+
+	p = allocComponent(CP_PRESSURE_PLATE);
+
+	e->data = p;
+}
+
 static void tick(void)
 {
 	PressurePlate *p;
@@ -80,7 +91,7 @@ static void tick(void)
 	{
 		if (prevWeight > 0)
 		{
-			activeEntities(p->targetName, 0);
+			activeEntities(p->target, 0);
 		}
 
 		self->atlasImage = idleTexture;
@@ -99,36 +110,26 @@ static void touch(Entity *other)
 {
 	PressurePlate *p;
 
-	if (other != NULL && other->type != ET_BULLET)
+	if (other != NULL)
 	{
 		p = (PressurePlate*)self->data;
 
 		if (p->weight == 0)
 		{
-			activeEntities(p->targetName, 1);
+			activeEntities(p->target, 1);
 
-			playPositionalSound(SND_PRESSURE_PLATE, CH_SWITCH, self->x, self->y, stage.player->x, stage.player->y);
+			playPositionalSound(SND_PRESSURE_PLATE, CH_SWITCH, self->x, self->y, getPlayer()->x, getPlayer()->y);
 		}
 
 		p->weight = 2;
 	}
 }
 
-static void load(cJSON *root)
+static void load(void)
 {
 	PressurePlate *p;
 
 	p = (PressurePlate*)self->data;
 
-	STRNCPY(p->targetName, cJSON_GetObjectItem(root, "targetName")->valuestring, MAX_NAME_LENGTH);
+	p->target = internTarget(p->targetName);
 }
-
-static void save(cJSON *root)
-{
-	PressurePlate *p;
-
-	p = (PressurePlate*)self->data;
-
-	cJSON_AddStringToObject(root, "targetName", p->targetName);
-}
-
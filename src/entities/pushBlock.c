@@ -22,10 +22,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "pushBlock.h"
 #include "../system/atlas.h"
 
-void initPushBlock(Entity *e)
+static EntityDef def = {
+	.typeName = "pushBlock",
+	.type = ET_STRUCTURE
+};
+
+void initPushBlockPrototype(Entity *e)
 {
-	e->typeName = "pushBlock";
-	e->type = ET_STRUCTURE;
+	e->def = &def;
 	e->atlasImage = getAtlasImage("gfx/entities/crate.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
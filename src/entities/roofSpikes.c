@@ -21,26 +21,32 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../common.h"
 #include "roofSpikes.h"
 #include "../system/atlas.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 
 static void touch(Entity *other);
 
-void initRoofSpikes(Entity *e)
+static EntityDef def = {
+	.typeName = "roofSpikes",
+	.type = ET_TRAP,
+	.tileLayer = TL_HAZARD,
+	.touch = touch
+};
+
+void initRoofSpikesPrototype(Entity *e)
 {
-	e->typeName = "roofSpikes";
-	e->type = ET_TRAP;
+	e->def = &def;
 	e->atlasImage = getAtlasImage("gfx/entities/roofSpikes.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
-	e->touch = touch;
 	e->flags = EF_WEIGHTLESS+EF_NO_ENT_CLIP+EF_STATIC;
 }
 
 static void touch(Entity *other)
 {
 	/* must hit to base of the spikes - looks better */
-	if (other != NULL && (other->type == ET_PLAYER || other->type == ET_CLONE))
+	if (other != NULL && isWalter(other))
 	{
 		if (other->y + other->h >= self->y + self->h)
 		{
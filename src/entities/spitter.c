@@ -20,44 +20,50 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "spitter.h"
-#include "../json/cJSON.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
 #include "../system/sound.h"
 #include "../world/entityFactory.h"
+#include "../world/entityPool.h"
+#include "../world/projectiles.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Stage stage;
 
 static void tick(void);
 static void activate(int active);
-static void fireBullet(void);
-static void load(cJSON *root);
-static void save(cJSON *root);
 
-static AtlasImage *bulletTexture;
-
-void initSpitter(Entity *e)
+static EntityField fields[] = {
+	{"facing", FT_FACING, 0},
+	{"interval", FT_INT, offsetof(Spitter, interval)},
+	{"enabled", FT_INT, offsetof(Spitter, enabled)}
+};
+
+static EntityDef def = {
+	.typeName = "spitter",
+	.type = ET_TRAP,
+	.tick = tick,
+	.activate = activate,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
+
+void initSpitterPrototype(Entity *e)
 {
-	Spitter *s;
-
-	s = malloc(sizeof(Spitter));
-	memset(s, 0, sizeof(Spitter));
-
-	e->typeName = "spitter";
-	e->type = ET_TRAP;
-	e->data = s;
+	e->def = &def;
 	e->atlasImage = getAtlasImage("gfx/entities/spitter.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_WEIGHTLESS+EF_NO_ENT_CLIP+EF_STATIC;
-	e->tick = tick;
-	e->activate = activate;
+}
 
-	bulletTexture = getAtlasImage("gfx/entities/spitterBullet.png", 1);
+void initSpitter(Entity *e)
+{
+	Spitter *s;
 
-	e->load = load;
-	e->save = save;
+	s = allocComponent(CP_SPITTER);
+
+	e->data = s;
 }
 
 static void tick(void)
@@ -68,9 +74,9 @@ static void tick(void)
 
 	if (s->enabled && --s->reload <= 0)
 	{
-		fireBullet();
+		fireProjectile(PT_SPIT, self);
 
-		playPositionalSound(SND_SPIT, CH_SPIT, self->x, self->y, stage.player->x, stage.player->y);
+		playPositionalSound(SND_SPIT, CH_SPIT, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 		s->reload = s->interval;
 	}
@@ -84,103 +90,3 @@ static void activate(int active)
 
 	s->enabled = !s->enabled;
 }
-
-static void load(cJSON *root)
-{
-	Spitter *s;
-
-	s = (Spitter*)self->data;
-
-	self->facing = strcmp(cJSON_GetObjectItem(root, "facing")->valuestring, "left") == 0 ? 0 : 1;
-	s->interval = cJSON_GetObjectItem(root, "interval")->valueint;
-	s->enabled = cJSON_GetObjectItem(root, "enabled")->valueint;
-}
-
-static void save(cJSON *root)
-{
-	Spitter *s;
-
-	s = (Spitter*)self->data;
-
-	cJSON_AddStringToObject(root, "facing", self->facing == 0 ? "left" : "right");
-	cJSON_AddNumberToObject(root, "interval", s->interval);
-	cJSON_AddNumberToObject(root, "enabled", s->enabled);
-}
-
-/* === Bullet */
-
-static void bulletTouch(Entity *other)
-{
-	Walter *w;
-
-	if (other != NULL)
-	{
-		if (other->type == ET_PLAYER || other->type == ET_CLONE)
-		{
-			w = (Walter*)other->data;
-
-			/* hit in the back */
-			if (self->facing == other->facing)
-			{
-				other->health = 0;
-			}
-			else if (w->equipment != EQ_MANHOLE_COVER)
-			{
-				other->health = 0;
-			}
-
-			self->health = 0;
-
-			playPositionalSound(SND_SPIT_HIT, CH_HIT, self->x, self->y, stage.player->x, stage.player->y);
-		}
-		else if (other->flags & EF_SOLID)
-		{
-			self->health = 0;
-
-			playPositionalSound(SND_SPIT_HIT, CH_HIT, self->x, self->y, stage.player->x, stage.player->y);
-		}
-	}
-	else
-	{
-		self->health = 0;
-
-		playPositionalSound(SND_SPIT_HIT, CH_HIT, self->x, self->y, stage.player->x, stage.player->y);
-	}
-}
-
-static void bulletDie(void)
-{
-	addSlimeBurstParticles(self->x, self->y);
-}
-
-static void fireBullet(void)
-{
-	Entity *e;
-
-	e = spawnEntity();
-
-	e->type = ET_BULLET;
-	e->typeName = "bullet";
-	e->x = self->x;
-	e->y = self->y;
-	e->facing = self->facing;
-	e->dx = self->facing ? 8 : -8;
-	e->flags = EF_WEIGHTLESS+EF_NO_MAP_BOUNDS;
-	e->atlasImage = bulletTexture;
-	e->w = e->atlasImage->rect.w;
-	e->h = e->atlasImage->rect.h;
-	e->touch = bulletTouch;
-	e->die = bulletDie;
-
-	/* center horizontally */
-	e->y += (self->w / 2) - (e->h / 2);
-
-	if (e->facing)
-	{
-		e->x += self->w;
-	}
-
-	e->light.g = 255;
-	e->light.a = 48;
-}
-
@@ -20,174 +20,146 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "toilet.h"
-#include "../json/cJSON.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
+#include "../system/animation.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Game game;
 extern Stage stage;
 
-static void erupt(void);
+#define PLUNGE_FRAME_TIME    16
+
+enum
+{
+	TS_IDLE,
+	TS_STINK,
+	TS_PLUNGING,
+	TS_ERUPT,
+	TS_ESCAPE
+};
+
+static void tick(void);
 static void idle(void);
-static void escape(void);
+static void plunging(void);
 static void touch(Entity *other);
-static void load(cJSON *root);
-static void save(cJSON *root);
+static void load(void);
 
 static AtlasImage *idleTexture;
-static AtlasImage *eruptFrames[2];
-static AtlasImage *escapeFrames[5];
-static AtlasImage *stinkFrames[2];
-static AtlasImage *plungingFrames[2];
-
-void initToilet(Entity *e)
+static AnimClip eruptClip = {.loop = 1};
+static AnimClip escapeClip;
+static AnimClip stinkClip = {.loop = 1};
+static AnimClip plungingClip = {.loop = 1};
+
+static EntityField fields[] = {
+	{"facing", FT_FACING, 0},
+	{"requiresPlunger", FT_FLAG, offsetof(Toilet, requiresPlunger)}
+};
+
+static EntityDef def = {
+	.typeName = "toilet",
+	.type = ET_TOILET,
+	.tick = tick,
+	.touch = touch,
+	.load = load,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
+
+void initToiletPrototype(Entity *e)
 {
-	Toilet *t;
 	char filename[MAX_FILENAME_LENGTH];
 	int i;
 
-	t = malloc(sizeof(Toilet));
-	memset(t, 0, sizeof(Toilet));
+	idleTexture = getAtlasImage("gfx/entities/toilet.png", 1);
 
+	/* the lid stays shut for a second, then Walter spins away and the toilet goes back to normal */
 	for (i = 0 ; i < 5 ; i++)
 	{
 		sprintf(filename, "gfx/entities/toiletEscape%d.png", i + 1);
 
-		escapeFrames[i] = getAtlasImage(filename, 1);
+		addAnimFrame(&escapeClip, getAtlasImage(filename, 1), i == 0 ? FPS : 8);
 	}
 
-	eruptFrames[0] = getAtlasImage("gfx/entities/toiletErupt1.png", 1);
-	eruptFrames[1] = getAtlasImage("gfx/entities/toiletErupt2.png", 1);
+	addAnimFrame(&escapeClip, idleTexture, 1);
 
-	stinkFrames[0] = getAtlasImage("gfx/entities/toiletStink1.png", 1);
-	stinkFrames[1] = getAtlasImage("gfx/entities/toiletStink2.png", 1);
+	addAnimFrame(&eruptClip, getAtlasImage("gfx/entities/toiletErupt1.png", 1), 30);
+	addAnimFrame(&eruptClip, getAtlasImage("gfx/entities/toiletErupt2.png", 1), 30);
 
-	plungingFrames[0] = getAtlasImage("gfx/entities/toiletPlunging1.png", 1);
-	plungingFrames[1] = getAtlasImage("gfx/entities/toiletPlunging2.png", 1);
+	addAnimFrame(&stinkClip, getAtlasImage("gfx/entities/toiletStink1.png", 1), 30);
+	addAnimFrame(&stinkClip, getAtlasImage("gfx/entities/toiletStink2.png", 1), 30);
 
-	idleTexture = getAtlasImage("gfx/entities/toilet.png", 1);
+	addAnimFrame(&plungingClip, getAtlasImage("gfx/entities/toiletPlunging1.png", 1), PLUNGE_FRAME_TIME);
+	addAnimFrame(&plungingClip, getAtlasImage("gfx/entities/toiletPlunging2.png", 1), PLUNGE_FRAME_TIME);
 
-	e->typeName = "toilet";
-	e->type = ET_TOILET;
-	e->data = t;
+	e->def = &def;
 	e->atlasImage = idleTexture;
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
-	e->flags = EF_NO_ENT_CLIP+EF_STATIC;
-	e->tick = idle;
-	e->touch = touch;
-
-	e->load = load;
-	e->save = save;
+	e->flags = EF_NO_ENT_CLIP+EF_STATIC+EF_SERIAL_TICK;
 }
 
-static void idle(void)
+void initToilet(Entity *e)
 {
-	if (stage.time / 60 == 0)
-	{
-		self->atlasImage = eruptFrames[0];
-
-		self->tick = erupt;
+	Toilet *t;
 
-		self->touch = NULL;
+	t = allocComponent(CP_TOILET);
 
-		game.stats[STAT_FAILS]++;
-	}
+	e->data = t;
 }
 
-static void stink(void)
+/* the animations are played by the renderer, so only the states that can change need a tick */
+static void tick(void)
 {
-	Toilet *t;
-
-	t = (Toilet*)self->data;
+	switch (self->state)
+	{
+		case TS_IDLE:
+			idle();
+			break;
 
-	t->animTimer++;
+		case TS_PLUNGING:
+			plunging();
+			break;
 
-	if (t->animTimer % 30 == 0)
-	{
-		if (++t->frameNum > 1)
-		{
-			t->frameNum = 0;
-		}
+		default:
+			break;
 	}
-
-	self->atlasImage = stinkFrames[t->frameNum];
 }
 
-static void plunging(void)
+static void idle(void)
 {
-	Toilet *t;
-
-	t = (Toilet*)self->data;
-
-	t->animTimer++;
-
-	if (t->animTimer % 16 == 0)
-	{
-		if (++t->frameNum > 1)
-		{
-			t->frameNum = 0;
-		}
-
-		playPositionalSound(SND_PLUNGE, CH_STRUCTURE, self->x, self->y, stage.player->x, stage.player->y);
-	}
-
-	self->atlasImage = plungingFrames[t->frameNum];
-
-	if (--t->requiresPlunger <= 0)
+	if (stage.time / 60 == 0)
 	{
-		self->tick = idle;
+		playAnimClip(self, &eruptClip);
 
-		self->atlasImage = idleTexture;
+		self->state = TS_ERUPT;
 
-		self->touch = touch;
+		game.stats[STAT_FAILS]++;
 	}
-
-	idle();
 }
 
-static void erupt(void)
+static void plunging(void)
 {
 	Toilet *t;
 
 	t = (Toilet*)self->data;
 
-	t->animTimer++;
-
-	if (t->animTimer % 30 == 0)
+	/* as the frame changes */
+	if (getAnimTime(self) % PLUNGE_FRAME_TIME == PLUNGE_FRAME_TIME - 1)
 	{
-		if (++t->frameNum > 1)
-		{
-			t->frameNum = 0;
-		}
-
-		self->atlasImage = eruptFrames[t->frameNum];
+		playPositionalSound(SND_PLUNGE, CH_STRUCTURE, self->x, self->y, getPlayer()->x, getPlayer()->y);
 	}
-}
-
-static void escape(void)
-{
-	Toilet *t;
-
-	t = (Toilet*)self->data;
 
-	if (--t->animTimer == 0)
+	if (--t->requiresPlunger <= 0)
 	{
-		t->animTimer = 8;
-
-		t->frameNum++;
+		self->state = TS_IDLE;
 
-		if (t->frameNum < 5)
-		{
-			self->atlasImage = escapeFrames[t->frameNum];
-		}
-		else
-		{
-			self->atlasImage = idleTexture;
-		}
+		self->anim = NULL;
 	}
+
+	idle();
 }
 
 static void touch(Entity *other)
@@ -195,39 +167,39 @@ static void touch(Entity *other)
 	Toilet *t;
 	Walter *w;
 
-	if (other != NULL)
+	/* nothing can use the toilet while it's erupting or being plunged */
+	if (other != NULL && self->state != TS_ERUPT && self->state != TS_PLUNGING)
 	{
 		t = (Toilet*)self->data;
 
 		if (!t->requiresPlunger)
 		{
-			if (other->type == ET_PLAYER)
+			/* in co-op, either Walter can finish the stage */
+			if (other->def->type == ET_PLAYER || other->def->type == ET_PARTNER)
 			{
 				addToiletSplashParticles(self->x + self->atlasImage->rect.w / 2, self->y + self->atlasImage->rect.h / 2);
 
-				self->tick = escape;
-
-				self->atlasImage = escapeFrames[0];
+				self->state = TS_ESCAPE;
 
-				t->animTimer = FPS;
+				playAnimClip(self, &escapeClip);
 
 				other->health = 0;
 
 				/* just remove player */
-				other->die = NULL;
+				other->state = PS_FLUSHED;
 
 				stage.status = SS_COMPLETE;
 
 				stage.nextStageTimer = FPS * 3;
 
-				playPositionalSound(SND_SPLASH, CH_CLOCK, self->x, self->y, stage.player->x, stage.player->y);
+				playPositionalSound(SND_SPLASH, CH_CLOCK, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
-				playPositionalSound(SND_FLUSH, CH_PLAYER, self->x, self->y, stage.player->x, stage.player->y);
+				playPositionalSound(SND_FLUSH, CH_PLAYER, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 				game.stats[STAT_STAGES_COMPLETED]++;
 			}
 		}
-		else if (other->type == ET_PLAYER || other->type == ET_CLONE)
+		else if (isWalter(other))
 		{
 			w = (Walter*)other->data;
 
@@ -235,9 +207,9 @@ static void touch(Entity *other)
 			{
 				w->equipment = EQ_NONE;
 
-				self->tick = plunging;
+				self->state = TS_PLUNGING;
 
-				self->touch = NULL;
+				playAnimClip(self, &plungingClip);
 			}
 			else
 			{
@@ -247,35 +219,19 @@ static void touch(Entity *other)
 	}
 }
 
-static void load(cJSON *root)
+static void load(void)
 {
 	Toilet *t;
 
 	t = (Toilet*)self->data;
 
-	self->facing = strcmp(cJSON_GetObjectItem(root, "facing")->valuestring, "left") == 0 ? 0 : 1;
-
-	if (cJSON_GetObjectItem(root, "requiresPlunger"))
+	/* authored as a flag, but counts down while the toilet stinks */
+	if (t->requiresPlunger)
 	{
 		t->requiresPlunger = FPS * 2;
 
-		self->atlasImage = stinkFrames[0];
+		playAnimClip(self, &stinkClip);
 
-		self->tick = stink;
+		self->state = TS_STINK;
 	}
 }
-
-static void save(cJSON *root)
-{
-	Toilet *t;
-
-	t = (Toilet*)self->data;
-
-	cJSON_AddStringToObject(root, "facing", self->facing == 0 ? "left" : "right");
-
-	if (t->requiresPlunger)
-	{
-		cJSON_AddNumberToObject(root, "requiresPlunger", 1);
-	}
-}
-
@@ -20,51 +20,63 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "trafficLight.h"
-#include "../json/cJSON.h"
 #include "../world/entities.h"
 #include "../system/atlas.h"
 #include "../entities/clone.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
+#include "../world/targets.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Stage stage;
 
 static void tick(void);
 static void toggle(void);
 static void touch(Entity *other);
-static void load(cJSON *root);
-static void save(cJSON *root);
+static void load(void);
 
 static AtlasImage *goTexture;
 static AtlasImage *stopTexture;
 
-void initTrafficLight(Entity *e)
+static EntityField fields[] = {
+	{"on", FT_INT, offsetof(TrafficLight, on)},
+	{"targetName", FT_STRING, offsetof(TrafficLight, targetName)}
+};
+
+static EntityDef def = {
+	.typeName = "trafficLight",
+	.type = ET_SWITCH,
+	.tick = tick,
+	.touch = touch,
+	.load = load,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
+
+void initTrafficLightPrototype(Entity *e)
 {
-	TrafficLight *t;
-
 	goTexture = getAtlasImage("gfx/entities/trafficLightGo.png", 1);
 	stopTexture = getAtlasImage("gfx/entities/trafficLightStop.png", 1);
 
-	t = malloc(sizeof(TrafficLight));
-	memset(t, 0, sizeof(TrafficLight));
-
-	e->typeName = "trafficLight";
-	e->type = ET_SWITCH;
-	e->data = t;
+	e->def = &def;
 	e->atlasImage = stopTexture;
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
-	e->tick = tick;
-	e->touch = touch;
 	e->flags = EF_NO_ENT_CLIP+EF_STATIC;
 
-	e->load = load;
-	e->save = save;
-
 	e->light.a = 48;
 	e->light.foreground = 1;
 }
 
+void initTrafficLight(Entity *e)
+{
+	TrafficLight *t;
+
+	t = allocComponent(CP_TRAFFIC_LIGHT);
+
+	e->data = t;
+}
+
 static void tick(void)
 {
 	TrafficLight *t;
@@ -91,11 +103,11 @@ static void touch(Entity *other)
 
 	if (other != NULL)
 	{
-		if (other->type == ET_PLAYER || other->type == ET_CLONE)
+		if (isWalter(other))
 		{
 			w = (Walter*)other->data;
 
-			if (w->action && (other->type == ET_PLAYER || (other->type == ET_CLONE && isValidCloneFrame(w))))
+			if (w->action && (other->def->type != ET_CLONE || isValidCloneFrame(w)))
 			{
 				w->action = 0;
 
@@ -113,7 +125,7 @@ static void toggle(void)
 
 	t->on = !t->on;
 
-	activeEntities(t->targetName, t->on);
+	activeEntities(t->target, t->on);
 
 	if (t->on)
 	{
@@ -124,17 +136,16 @@ static void toggle(void)
 		self->atlasImage = stopTexture;
 	}
 
-	playPositionalSound(SND_TRAFFIC_LIGHT, CH_SWITCH, self->x, self->y, stage.player->x, stage.player->y);
+	playPositionalSound(SND_TRAFFIC_LIGHT, CH_SWITCH, self->x, self->y, getPlayer()->x, getPlayer()->y);
 }
 
-static void load(cJSON *root)
+static void load(void)
 {
 	TrafficLight *t;
 
 	t = (TrafficLight*)self->data;
 
-	t->on = cJSON_GetObjectItem(root, "on")->valueint;
-	STRNCPY(t->targetName, cJSON_GetObjectItem(root, "targetName")->valuestring, MAX_NAME_LENGTH);
+	t->target = internTarget(t->targetName);
 
 	if (t->on)
 	{
@@ -149,14 +160,3 @@ static void load(cJSON *root)
 		self->atlasImage = stopTexture;
 	}
 }
-
-static void save(cJSON *root)
-{
-	TrafficLight *t;
-
-	t = (TrafficLight*)self->data;
-
-	cJSON_AddStringToObject(root, "targetName", t->targetName);
-	cJSON_AddNumberToObject(root, "on", t->on);
-}
-
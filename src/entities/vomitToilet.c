@@ -22,50 +22,25 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "vomitToilet.h"
 #include "../json/cJSON.h"
 #include "../system/atlas.h"
+#include "../system/animation.h"
 
-extern Entity *self;
+static AnimClip vomitClip = {.loop = 1};
 
-static void tick(void);
+static EntityDef def = {
+	.typeName = "vomitToilet",
+	.type = ET_VOMIT_TOILET
+};
 
-static AtlasImage *vomitFrames[2];
-
-void initVomitToilet(Entity *e)
+void initVomitToiletPrototype(Entity *e)
 {
-	Toilet *t;
-
-	t = malloc(sizeof(Toilet));
-	memset(t, 0, sizeof(Toilet));
-
-	vomitFrames[0] = getAtlasImage("gfx/entities/vomitToilet1.png", 1);
-	vomitFrames[1] = getAtlasImage("gfx/entities/vomitToilet2.png", 1);
+	addAnimFrame(&vomitClip, getAtlasImage("gfx/entities/vomitToilet1.png", 1), FPS / 2);
+	addAnimFrame(&vomitClip, getAtlasImage("gfx/entities/vomitToilet2.png", 1), FPS / 2);
 
-	e->typeName = "vomitToilet";
+	e->def = &def;
 	e->facing = 1;
-	e->type = ET_VOMIT_TOILET;
-	e->data = t;
-	e->atlasImage = vomitFrames[0];
+	e->atlasImage = vomitClip.frames[0];
+	e->anim = &vomitClip;
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_NO_ENT_CLIP+EF_STATIC;
-	e->tick = tick;
 }
-
-static void tick(void)
-{
-	Toilet *t;
-
-	t = (Toilet*)self->data;
-
-	if (--t->animTimer <= 0)
-	{
-		if (++t->frameNum >= 2)
-		{
-			t->frameNum = 0;
-		}
-
-		t->animTimer = FPS / 2;
-	}
-
-	self->atlasImage = vomitFrames[t->frameNum];
-}
-
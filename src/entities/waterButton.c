@@ -20,26 +20,41 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "waterButton.h"
-#include "../json/cJSON.h"
 #include "../world/entities.h"
 #include "../system/atlas.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
+#include "../world/targets.h"
 
 #define WATER_LEVEL_MAX    6
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Stage stage;
 
 static void tick(void);
-static void load(cJSON *root);
-static void save(cJSON *root);
-static void touch(Entity *other);
+static void load(void);
+static void hit(int projectileType);
 
 static AtlasImage *textures[WATER_LEVEL_MAX];
 
-void initWaterButton(Entity *e)
+static EntityField fields[] = {
+	{"emptyRate", FT_INT, offsetof(WaterButton, emptyRate)},
+	{"facing", FT_FACING, 0},
+	{"targetName", FT_STRING, offsetof(WaterButton, targetName)}
+};
+
+static EntityDef def = {
+	.typeName = "waterButton",
+	.type = ET_STRUCTURE,
+	.tick = tick,
+	.hit = hit,
+	.load = load,
+	.fields = fields,
+	.numFields = sizeof(fields) / sizeof(EntityField)
+};
+
+void initWaterButtonPrototype(Entity *e)
 {
-	WaterButton *w;
 	int i;
 	char filename[MAX_NAME_LENGTH];
 
@@ -50,21 +65,20 @@ void initWaterButton(Entity *e)
 		textures[i] = getAtlasImage(filename, 1);
 	}
 
-	w = malloc(sizeof(WaterButton));
-	memset(w, 0, sizeof(WaterButton));
-
-	e->typeName = "waterButton";
-	e->type = ET_STRUCTURE;
-	e->data = w;
-	e->tick = tick;
-	e->touch = touch;
+	e->def = &def;
 	e->atlasImage = textures[0];
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_SOLID+EF_WEIGHTLESS+EF_STATIC;
+}
+
+void initWaterButton(Entity *e)
+{
+	WaterButton *w;
+
+	w = allocComponent(CP_WATER_BUTTON);
 
-	e->load = load;
-	e->save = save;
+	e->data = w;
 }
 
 static void tick(void)
@@ -74,80 +88,63 @@ static void tick(void)
 
 	w = (WaterButton*)self->data;
 
-	self->atlasImage = textures[w->waterLevel];
-
 	if (w->emptyRate > 0 && --w->emptyTimer <= 0)
 	{
 		oldValue = w->waterLevel;
 
 		w->waterLevel = MAX(w->waterLevel - 1, 0);
 
+		self->atlasImage = textures[w->waterLevel];
+
 		w->emptyTimer = w->emptyRate;
 
 		if (w->inflated && oldValue != w->waterLevel)
 		{
-			playPositionalSound(SND_DEFLATE, CH_SWITCH, self->x, self->y, stage.player->x, stage.player->y);
+			playPositionalSound(SND_DEFLATE, CH_SWITCH, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 			if (w->waterLevel == 0)
 			{
 				w->inflated = 0;
 
-				activeEntities(w->targetName, 0);
+				activeEntities(w->target, 0);
 			}
 		}
 	}
 }
 
-static void touch(Entity *other)
+static void hit(int projectileType)
 {
 	WaterButton *w;
 	int oldValue;
 
-	if (other != NULL && other->type == ET_BULLET)
-	{
-		other->health = 0;
+	w = (WaterButton*)self->data;
 
-		w = (WaterButton*)self->data;
+	oldValue = w->waterLevel;
 
-		oldValue = w->waterLevel;
+	w->emptyTimer = w->emptyRate;
 
-		w->emptyTimer = w->emptyRate;
+	w->waterLevel = MIN(w->waterLevel + 1, WATER_LEVEL_MAX - 1);
 
-		w->waterLevel = MIN(w->waterLevel + 1, WATER_LEVEL_MAX - 1);
+	self->atlasImage = textures[w->waterLevel];
 
-		if (!w->inflated && oldValue != w->waterLevel)
-		{
-			playPositionalSound(SND_INFLATE, CH_SWITCH, self->x, self->y, stage.player->x, stage.player->y);
+	if (!w->inflated && oldValue != w->waterLevel)
+	{
+		playPositionalSound(SND_INFLATE, CH_SWITCH, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
-			if (w->waterLevel == WATER_LEVEL_MAX - 1)
-			{
-				w->inflated = 1;
+		if (w->waterLevel == WATER_LEVEL_MAX - 1)
+		{
+			w->inflated = 1;
 
-				activeEntities(w->targetName, 1);
-			}
+			activeEntities(w->target, 1);
 		}
 	}
 }
 
-static void load(cJSON *root)
+static void load(void)
 {
 	WaterButton *w;
 
 	w = (WaterButton*)self->data;
 
-	w->emptyRate = cJSON_GetObjectItem(root, "emptyRate")->valueint;
-	self->facing = strcmp(cJSON_GetObjectItem(root, "facing")->valuestring, "left") == 0 ? 0 : 1;
-	STRNCPY(w->targetName, cJSON_GetObjectItem(root, "targetName")->valuestring, MAX_NAME_LENGTH);
+	w->target = internTarget(w->targetName);
 }
-
-static void save(cJSON *root)
-{
-	WaterButton *w;
-
-	w = (WaterButton*)self->data;
-
-	cJSON_AddNumberToObject(root, "emptyRate", w->emptyRate);
-	cJSON_AddStringToObject(root, "facing", self->facing == 0 ? "left" : "right");
-	cJSON_AddStringToObject(root, "targetName", w->targetName);
-}
-
@@ -20,58 +20,51 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "waterPistol.h"
+#include "../system/animation.h"
 #include "../system/atlas.h"
 #include "../world/particles.h"
 #include "../system/sound.h"
+#include "../world/entityPool.h"
 
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Game game;
 extern Stage stage;
 
-static void tick(void);
 static void touch(Entity *other);
 static void die(void);
 
-void initWaterPistol(Entity *e)
-{
-	Collectable *p;
+static AnimClip bobClip = {.bob = 5};
 
-	p = malloc(sizeof(Collectable));
-	memset(p, 0, sizeof(Collectable));
+static EntityDef def = {
+	.typeName = "waterPistol",
+	.type = ET_ITEM,
+	.touch = touch,
+	.die = die
+};
 
-	p->bobValue = rand() % 10;
-
-	e->typeName = "waterPistol";
-	e->type = ET_ITEM;
-	e->data = p;
+void initWaterPistolPrototype(Entity *e)
+{
+	e->def = &def;
 	e->atlasImage = getAtlasImage("gfx/entities/waterPistol.png", 1);
 	e->w = e->atlasImage->rect.w;
 	e->h = e->atlasImage->rect.h;
 	e->flags = EF_WEIGHTLESS+EF_NO_ENT_CLIP+EF_STATIC;
-	e->tick = tick;
-	e->touch = touch;
-	e->die = die;
+	e->anim = &bobClip;
 
 	e->light.g = 255;
 	e->light.a = 64;
 }
 
-static void tick(void)
+void initWaterPistol(Entity *e)
 {
-	Collectable *p;
-
-	p = (Collectable*)self->data;
-
-	p->bobValue += 0.1;
-
-	self->y += sin(p->bobValue) * 0.5;
+	initBobPhase(e);
 }
 
 static void touch(Entity *other)
 {
 	Walter *w;
 
-	if (self->health > 0 && other != NULL && (other->type == ET_PLAYER || other->type == ET_CLONE))
+	if (self->health > 0 && other != NULL && isWalter(other))
 	{
 		w = (Walter*)other->data;
 
@@ -81,7 +74,7 @@ static void touch(Entity *other)
 
 			w->equipment = EQ_WATER_PISTOL;
 
-			playPositionalSound(SND_PLUNGER, CH_ITEM, self->x, self->y, stage.player->x, stage.player->y);
+			playPositionalSound(SND_PLUNGER, CH_ITEM, self->x, self->y, getPlayer()->x, getPlayer()->y);
 
 			game.stats[STAT_WATER_PISTOLS]++;
 		}
@@ -19,3 +19,4 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 void initWaterPistol(Entity *e);
+void initWaterPistolPrototype(Entity *e);
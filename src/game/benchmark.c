@@ -0,0 +1,307 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "benchmark.h"
+#include "../game/env.h"
+#include "../world/stage.h"
+#include "../world/entities.h"
+#include "../json/cJSON.h"
+#include "../system/io.h"
+#include "../world/entityFactory.h"
+#include "../world/entitySerialiser.h"
+#include "../world/snapshot.h"
+#include "../world/targets.h"
+#include "../world/map.h"
+#include "../world/entityPool.h"
+
+extern App app;
+extern Game game;
+extern Stage stage;
+
+static void reportSizes(void);
+static double timeEntities(int num, int frames, int minEnts);
+static void addOtherStages(int num, int minEnts);
+static int isClear(int x, int y);
+static void timeSerialisation(int num, int frames);
+static void timeEnvs(int num, int frames);
+static double toMicroseconds(Uint64 time, int n);
+
+/*
+ * Times the phased entity update on a stage, with and without grouping the entities by def,
+ * both as the stage is and with the entities of the stages after it added, where they fit, until there
+ * are BENCHMARK_MIN_ENTS, as none of the stages that ship are large enough to need the phased update.
+ */
+void runBenchmark(int num, int frames)
+{
+	double grouped, spawnOrder;
+	int minEnts;
+
+	app.headless = 1;
+
+	reportSizes();
+
+	app.dev.phased = 1;
+
+	for (minEnts = 0 ; minEnts <= BENCHMARK_MIN_ENTS ; minEnts += BENCHMARK_MIN_ENTS)
+	{
+		app.dev.spawnOrder = 0;
+		grouped = timeEntities(num, frames, minEnts);
+
+		app.dev.spawnOrder = 1;
+		spawnOrder = timeEntities(num, frames, minEnts);
+
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Stage %d, %d frames, %d entities: %.4fms per frame grouped by def, %.4fms in spawn order", num, frames, app.dev.ents, grouped, spawnOrder);
+	}
+
+	timeSerialisation(num, frames);
+
+	timeEnvs(num, frames);
+
+	exit(0);
+}
+
+/* what an entity costs now that it points at its def, against carrying its own copy of it as it used to */
+static void reportSizes(void)
+{
+	int i;
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Entity: %d bytes, %d with its own copy of its %d byte def", (int)sizeof(Entity), (int)(sizeof(Entity) - sizeof(EntityDef*) + sizeof(EntityDef)), (int)sizeof(EntityDef));
+
+	for (i = 0 ; i < CP_MAX ; i++)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "%s: %d bytes", getComponentName(i), getComponentSize(i));
+	}
+}
+
+static double timeEntities(int num, int frames, int minEnts)
+{
+	Uint64 start, total;
+	int i;
+
+	initStage();
+
+	stage.num = num;
+
+	loadStage(0);
+
+	addOtherStages(num, minEnts);
+
+	total = 0;
+
+	for (i = 0 ; i < frames ; i++)
+	{
+		start = SDL_GetPerformanceCounter();
+
+		doEntities();
+
+		total += SDL_GetPerformanceCounter() - start;
+	}
+
+	destroyStage();
+
+	return (total * 1000.0) / SDL_GetPerformanceFrequency() / frames;
+}
+
+/* everything but the player is brought in from the stages that follow, in turn, each where it stands in its own stage */
+static void addOtherStages(int num, int minEnts)
+{
+	char filename[MAX_FILENAME_LENGTH], *json;
+	cJSON *root, *node;
+	Entity *e;
+	int n, other, tries;
+
+	n = 0;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		n++;
+	}
+
+	other = num;
+
+	for (tries = 0 ; n < minEnts && tries < game.numStages ; tries++)
+	{
+		other = (other % game.numStages) + 1;
+
+		if (other == num)
+		{
+			continue;
+		}
+
+		sprintf(filename, "data/stages/%03d.json", other);
+
+		json = readFile(getFileLocation(filename));
+
+		root = cJSON_Parse(json);
+
+		for (node = cJSON_GetObjectItem(root, "entities")->child ; node != NULL && n < minEnts ; node = node->next)
+		{
+			if (strcmp(cJSON_GetObjectItem(node, "type")->valuestring, "player") != 0 && isClear(cJSON_GetObjectItem(node, "x")->valueint, cJSON_GetObjectItem(node, "y")->valueint))
+			{
+				initEntity(node);
+
+				n++;
+			}
+		}
+
+		cJSON_Delete(root);
+
+		free(json);
+	}
+
+	indexTargets();
+}
+
+/* whether something placed here would be out of this stage's walls and over one of its floors, rather than pushed out of them or off the stage */
+static int isClear(int x, int y)
+{
+	int mx, my;
+
+	mx = x / TILE_SIZE;
+
+	my = (y / TILE_SIZE) + 1;
+
+	while (isInsideMap(mx, my) && stage.map[mx][my] == 0)
+	{
+		my++;
+	}
+
+	if (!isInsideMap(mx, my))
+	{
+		return 0;
+	}
+
+	for (mx = x / TILE_SIZE ; mx <= (x + (TILE_SIZE / 2) - 1) / TILE_SIZE ; mx++)
+	{
+		for (my = y / TILE_SIZE ; my <= (y + (TILE_SIZE / 2) - 1) / TILE_SIZE ; my++)
+		{
+			if (!isInsideMap(mx, my) || stage.map[mx][my] != 0)
+			{
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+/* times writing and reading the stage's entities as compiled records, once per frame, against reading them from its JSON */
+static void timeSerialisation(int num, int frames)
+{
+	char filename[MAX_FILENAME_LENGTH], *json;
+	Uint64 start, serialise, deserialise, parse;
+	cJSON *root, *node;
+	Snapshot s;
+	int i, n;
+
+	initStage();
+
+	stage.num = num;
+
+	loadStage(0);
+
+	sprintf(filename, "data/stages/%03d.json", num);
+
+	json = readFile(getFileLocation(filename));
+
+	root = cJSON_Parse(json);
+
+	memset(&s, 0, sizeof(Snapshot));
+
+	serialise = deserialise = parse = 0;
+
+	n = 0;
+
+	for (i = 0 ; i < frames ; i++)
+	{
+		s.size = 0;
+
+		start = SDL_GetPerformanceCounter();
+
+		n = serialiseEntities(&s);
+
+		serialise += SDL_GetPerformanceCounter() - start;
+
+		clearEntities();
+		clearTargets();
+
+		start = SDL_GetPerformanceCounter();
+
+		deserialiseEntities(s.data, s.size, n);
+
+		deserialise += SDL_GetPerformanceCounter() - start;
+
+		clearEntities();
+		clearTargets();
+
+		start = SDL_GetPerformanceCounter();
+
+		for (node = cJSON_GetObjectItem(root, "entities")->child ; node != NULL ; node = node->next)
+		{
+			initEntity(node);
+		}
+
+		parse += SDL_GetPerformanceCounter() - start;
+	}
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Stage %d: %d entities, %d bytes compiled: %.3fus to serialise each, %.3fus to deserialise, %.3fus to load from JSON", num, n, s.size, toMicroseconds(serialise, frames * n), toMicroseconds(deserialise, frames * n), toMicroseconds(parse, frames * n));
+
+	free(s.data);
+
+	cJSON_Delete(root);
+
+	free(json);
+
+	destroyStage();
+}
+
+/* steps a batch of instances as an agent would, each holding one control at a time for a quarter of a second */
+static void timeEnvs(int num, int frames)
+{
+	EnvBatch *b;
+	Uint64 start, total;
+	int actions[ENV_BENCHMARK_ENVS], i, j;
+
+	b = createEnvs(num, ENV_BENCHMARK_ENVS);
+
+	start = SDL_GetPerformanceCounter();
+
+	for (i = 0 ; i < frames ; i++)
+	{
+		for (j = 0 ; j < ENV_BENCHMARK_ENVS ; j++)
+		{
+			actions[j] = 1 << (((i / (FPS / 4)) + j) % CONTROL_CLONE);
+		}
+
+		stepEnvs(b, actions);
+	}
+
+	total = SDL_GetPerformanceCounter() - start;
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Stage %d: %d envs, %.3fus per env step, %.0f env steps per second", num, ENV_BENCHMARK_ENVS, toMicroseconds(total, frames * ENV_BENCHMARK_ENVS), (frames * ENV_BENCHMARK_ENVS) / MAX(total * 1.0 / SDL_GetPerformanceFrequency(), 0.000001));
+
+	destroyEnvs(b);
+}
+
+static double toMicroseconds(Uint64 time, int n)
+{
+	return (time * 1000000.0) / SDL_GetPerformanceFrequency() / MAX(n, 1);
+}
@@ -27,7 +27,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../world/stage.h"
 #include "../system/text.h"
 #include "../world/entities.h"
+#include "../world/entityPool.h"
+#include "../world/recording.h"
 #include "../system/atlas.h"
+#include "../system/spriteBatch.h"
 
 extern App app;
 extern Stage stage;
@@ -45,14 +48,15 @@ void initEnding(void)
 {
 	stage.entityTail = &stage.entityHead;
 	stage.particleTail = &stage.particleHead;
-	stage.cloneDataTail = &stage.cloneDataHead;
+
+	startRecording();
 
 	stage.num = 0;
 
 	loadStage(0);
 
 	/* prevent player control */
-	stage.player->tick = NULL;
+	getPlayer()->state = PS_FROZEN;
 
 	initWipe(WIPE_FADE);
 
@@ -113,27 +117,24 @@ static void drawDarkness(void)
 
 	dest.y += 150;
 
-	SDL_RenderCopyEx(app.renderer, darknessTexture->texture, &darknessTexture->rect, &dest, 0, NULL, SDL_FLIP_NONE);
+	drawSprite(darknessTexture->texture, &darknessTexture->rect, &dest, SDL_FLIP_NONE, app.colors.white);
 }
 
 static void focusOnVomit(void)
 {
 	Entity *e;
 
-	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
-	{
-		if (e->type == ET_VOMIT_TOILET)
-		{
-			stage.camera.x = (int) e->x + (e->w / 2);
-			stage.camera.y = (int) e->y + (e->h / 2);
+	e = stage.typeHead[ET_VOMIT_TOILET];
 
-			stage.camera.x -= (SCREEN_WIDTH / 2);
-			stage.camera.y -= (SCREEN_HEIGHT / 2);
+	if (e != NULL)
+	{
+		stage.camera.x = (int) e->x + (e->w / 2);
+		stage.camera.y = (int) e->y + (e->h / 2);
 
-			stage.camera.y -= 200;
+		stage.camera.x -= (SCREEN_WIDTH / 2);
+		stage.camera.y -= (SCREEN_HEIGHT / 2);
 
-			return;
-		}
+		stage.camera.y -= 200;
 	}
 }
 
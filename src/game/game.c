@@ -167,6 +167,8 @@ static void loadConfigFile(const char *filename)
 	app.config.keyControls[CONTROL_USE] = cJSON_GetObjectItem(controls, "use")->valueint;
 	app.config.keyControls[CONTROL_CLONE] = cJSON_GetObjectItem(controls, "clone")->valueint;
 	app.config.keyControls[CONTROL_RESTART] = cJSON_GetObjectItem(controls, "restart")->valueint;
+	app.config.keyControls[CONTROL_REWIND] = getJSONIntVal(controls, "rewind", SDL_SCANCODE_R);
+	app.config.keyControls[CONTROL_FAST_FORWARD] = getJSONIntVal(controls, "fastForward", SDL_SCANCODE_F);
 	app.config.keyControls[CONTROL_PAUSE] = cJSON_GetObjectItem(controls, "pause")->valueint;
 
 	controls = cJSON_GetObjectItem(root, "joypadControls");
@@ -177,6 +179,8 @@ static void loadConfigFile(const char *filename)
 	app.config.joypadControls[CONTROL_USE] = cJSON_GetObjectItem(controls, "use")->valueint;
 	app.config.joypadControls[CONTROL_CLONE] = cJSON_GetObjectItem(controls, "clone")->valueint;
 	app.config.joypadControls[CONTROL_RESTART] = cJSON_GetObjectItem(controls, "restart")->valueint;
+	app.config.joypadControls[CONTROL_REWIND] = getJSONIntVal(controls, "rewind", -1);
+	app.config.joypadControls[CONTROL_FAST_FORWARD] = getJSONIntVal(controls, "fastForward", -1);
 	app.config.joypadControls[CONTROL_PAUSE] = cJSON_GetObjectItem(controls, "pause")->valueint;
 
 	cJSON_Delete(root);
@@ -207,6 +211,8 @@ void saveConfig(void)
 	cJSON_AddNumberToObject(controlsJSON, "use", app.config.keyControls[CONTROL_USE]);
 	cJSON_AddNumberToObject(controlsJSON, "clone", app.config.keyControls[CONTROL_CLONE]);
 	cJSON_AddNumberToObject(controlsJSON, "restart", app.config.keyControls[CONTROL_RESTART]);
+	cJSON_AddNumberToObject(controlsJSON, "rewind", app.config.keyControls[CONTROL_REWIND]);
+	cJSON_AddNumberToObject(controlsJSON, "fastForward", app.config.keyControls[CONTROL_FAST_FORWARD]);
 	cJSON_AddNumberToObject(controlsJSON, "pause", app.config.keyControls[CONTROL_PAUSE]);
 	cJSON_AddItemToObject(root, "keyControls", controlsJSON);
 
@@ -218,6 +224,8 @@ void saveConfig(void)
 	cJSON_AddNumberToObject(controlsJSON, "use", app.config.joypadControls[CONTROL_USE]);
 	cJSON_AddNumberToObject(controlsJSON, "clone", app.config.joypadControls[CONTROL_CLONE]);
 	cJSON_AddNumberToObject(controlsJSON, "restart", app.config.joypadControls[CONTROL_RESTART]);
+	cJSON_AddNumberToObject(controlsJSON, "rewind", app.config.joypadControls[CONTROL_REWIND]);
+	cJSON_AddNumberToObject(controlsJSON, "fastForward", app.config.joypadControls[CONTROL_FAST_FORWARD]);
 	cJSON_AddNumberToObject(controlsJSON, "pause", app.config.joypadControls[CONTROL_PAUSE]);
 	cJSON_AddItemToObject(root, "joypadControls", controlsJSON);
 
@@ -0,0 +1,787 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "linter.h"
+#include "../json/cJSON.h"
+#include "../system/io.h"
+#include "../system/jobs.h"
+#include "../system/util.h"
+#include "../world/entityFactory.h"
+#include "../world/map.h"
+
+static void lintSlice(int slice, int numSlices);
+static void lintStage(StageLint *l);
+static void checkEntities(StageLint *l, cJSON *entities);
+static void checkTargets(StageLint *l, cJSON *entities);
+static void checkOverlaps(StageLint *l, cJSON *entities);
+static void checkReachable(StageLint *l, LintMap *m, cJSON *entities, int clones);
+static int loadMap(LintMap *m, cJSON *root);
+static void addSurfaces(LintMap *m, cJSON *e);
+static void addPushedSurface(LintMap *m, int x, int y, int w, int h);
+static void addSurface(LintMap *m, int x, int y, int w);
+static int surfaceComparator(const void *a, const void *b);
+static int findSurface(LintMap *m, float y);
+static void expandGround(LintMap *m, SDL_FPoint p);
+static void standOnClone(LintMap *m, SDL_FPoint p);
+static void simulate(LintMap *m, float x, float y, float dy, int first, int k, int second);
+static void addGround(LintMap *m, float x, float y);
+static int isSolid(LintMap *m, int mx, int my);
+static void touch(LintMap *m, int x, int y, int w, int h);
+static int isTouched(LintMap *m, int x, int y, int w, int h);
+static int isPickup(const char *type);
+static char *getString(cJSON *e, const char *name);
+static Prototype *findPrototype(const char *type);
+static void addProblem(StageLint *l, const char *format, ...);
+
+static StageLint *lints;
+static int numLints;
+
+/*
+ * What's tried from everywhere the player can stand: the dy they start with, what's held for
+ * the first so many frames, and what's held after. A step is long enough to reach the next
+ * LINT_GROUND_CELL, and if it's off an edge, the fall carries on, turns back or stops. A
+ * jump goes straight, or drifts off, stops or turns back partway.
+ */
+static int moves[][4] = {
+	{0, -1, LINT_GROUND_CELL / PLAYER_MOVE_SPEED, -1},
+	{0, -1, LINT_GROUND_CELL / PLAYER_MOVE_SPEED, 0},
+	{0, -1, LINT_GROUND_CELL / PLAYER_MOVE_SPEED, 1},
+	{0, 1, LINT_GROUND_CELL / PLAYER_MOVE_SPEED, 1},
+	{0, 1, LINT_GROUND_CELL / PLAYER_MOVE_SPEED, 0},
+	{0, 1, LINT_GROUND_CELL / PLAYER_MOVE_SPEED, -1},
+	{-20, -1, 0, -1},
+	{-20, 0, 0, 0},
+	{-20, 1, 0, 1},
+	{-20, 0, 6, -1},
+	{-20, 0, 6, 1},
+	{-20, 0, 12, -1},
+	{-20, 0, 12, 1},
+	{-20, -1, 6, 0},
+	{-20, 1, 6, 0},
+	{-20, -1, 12, 0},
+	{-20, 1, 12, 0},
+	{-20, -1, 8, 1},
+	{-20, 1, 8, -1}
+};
+
+/*
+ * Checks every stage without playing any of them: that each entity is of a known type, that
+ * switches name something that can be switched, that nothing has been placed on top of
+ * anything else, and that every coin, item, key and toilet can be got to. The last is found by
+ * moving a box the size of the player from where they start, walking, falling and jumping as
+ * the player does (PLAYER_MOVE_SPEED, dy of -20, gravity of 1.5), against the tiles and the
+ * tops of solid things: doors open or shut, platforms anywhere along their paths and push
+ * blocks anywhere along the floor they drop to. A clone can be left anywhere the player has
+ * stood, so once nowhere new can be got to, the player is stood on top of each of those places,
+ * and then on top of that, as many times as the stage has clones. Hazards are taken to be
+ * harmless, so it can miss a stage that can't be done. The stages are read in first, then
+ * linted side by side, one per job.
+ */
+void lintStages(void)
+{
+	char **filenames, filename[MAX_FILENAME_LENGTH], *line;
+	Uint64 start;
+	int i, n, problems;
+
+	start = SDL_GetPerformanceCounter();
+
+	filenames = getFileList("data/stages", &n);
+
+	lints = malloc(sizeof(StageLint) * MAX(n, 1));
+	memset(lints, 0, sizeof(StageLint) * MAX(n, 1));
+
+	numLints = 0;
+
+	for (i = 0 ; i < n ; i++)
+	{
+		/* the title and ending stages aren't played */
+		if (strstr(filenames[i], ".json") != NULL && atoi(filenames[i]) != 0 && atoi(filenames[i]) != 999)
+		{
+			sprintf(filename, "data/stages/%s", filenames[i]);
+
+			lints[numLints].num = atoi(filenames[i]);
+			lints[numLints].json = readFile(getFileLocation(filename));
+
+			numLints++;
+		}
+
+		free(filenames[i]);
+	}
+
+	free(filenames);
+
+	runJobs(lintSlice);
+
+	problems = 0;
+
+	for (i = 0 ; i < numLints ; i++)
+	{
+		if (lints[i].report != NULL)
+		{
+			for (line = strtok(lints[i].report, "\n") ; line != NULL ; line = strtok(NULL, "\n"))
+			{
+				SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "Stage %03d: %s", lints[i].num, line);
+			}
+		}
+
+		problems += lints[i].problems;
+
+		free(lints[i].report);
+		free(lints[i].json);
+	}
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Linted %d stages in %.1fms: %d problems", numLints, (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency(), problems);
+
+	free(lints);
+
+	exit(problems > 0);
+}
+
+static void lintSlice(int slice, int numSlices)
+{
+	int i;
+
+	for (i = slice ; i < numLints ; i += numSlices)
+	{
+		lintStage(&lints[i]);
+	}
+}
+
+static void lintStage(StageLint *l)
+{
+	cJSON *root, *entities;
+	LintMap *m;
+
+	root = cJSON_Parse(l->json);
+
+	entities = root != NULL ? cJSON_GetObjectItem(root, "entities") : NULL;
+
+	if (entities == NULL)
+	{
+		addProblem(l, "couldn't be read");
+
+		cJSON_Delete(root);
+
+		return;
+	}
+
+	checkEntities(l, entities);
+
+	checkTargets(l, entities);
+
+	checkOverlaps(l, entities);
+
+	m = malloc(sizeof(LintMap));
+	memset(m, 0, sizeof(LintMap));
+
+	if (loadMap(m, root))
+	{
+		checkReachable(l, m, entities, getJSONIntVal(root, "cloneLimit", 0));
+	}
+	else
+	{
+		addProblem(l, "map is missing or too short");
+	}
+
+	free(m->visited);
+	free(m->queue);
+	free(m->surfaces);
+	free(m);
+
+	cJSON_Delete(root);
+}
+
+static void checkEntities(StageLint *l, cJSON *entities)
+{
+	cJSON *e;
+	char *type;
+	int players, toilets, plungers, plungerToilets;
+
+	players = toilets = plungers = plungerToilets = 0;
+
+	for (e = entities->child ; e != NULL ; e = e->next)
+	{
+		type = getString(e, "type");
+
+		if (findPrototype(type) == NULL)
+		{
+			addProblem(l, "unknown entity type '%s' at %d,%d", type, getJSONIntVal(e, "x", 0), getJSONIntVal(e, "y", 0));
+		}
+
+		players += strcmp(type, "player") == 0;
+
+		toilets += strcmp(type, "toilet") == 0 || strcmp(type, "finalToilet") == 0;
+
+		plungers += strcmp(type, "plunger") == 0;
+
+		plungerToilets += strcmp(type, "toilet") == 0 && getJSONIntVal(e, "requiresPlunger", 0);
+	}
+
+	if (players != 1)
+	{
+		addProblem(l, "has %d players", players);
+	}
+
+	if (toilets == 0)
+	{
+		addProblem(l, "has no toilet");
+	}
+
+	if (plungerToilets > 0 && plungers == 0)
+	{
+		addProblem(l, "has a toilet that needs a plunger, but no plunger");
+	}
+}
+
+/* everything a switch names must be something that can be switched */
+static void checkTargets(StageLint *l, cJSON *entities)
+{
+	cJSON *e, *other;
+	Prototype *p;
+	char *target;
+	int found;
+
+	for (e = entities->child ; e != NULL ; e = e->next)
+	{
+		target = getString(e, "targetName");
+
+		if (cJSON_GetObjectItem(e, "targetName") != NULL)
+		{
+			found = 0;
+
+			for (other = entities->child ; other != NULL && !found ; other = other->next)
+			{
+				p = findPrototype(getString(other, "type"));
+
+				found = p != NULL && p->entity.def->activate != NULL && strcmp(getString(other, "name"), target) == 0;
+			}
+
+			if (!found)
+			{
+				addProblem(l, "%s at %d,%d targets '%s', but nothing of that name can be activated", getString(e, "type"), getJSONIntVal(e, "x", 0), getJSONIntVal(e, "y", 0), target);
+			}
+		}
+	}
+}
+
+/* two of the same type in the same place is almost certainly a mistake in the editor */
+static void checkOverlaps(StageLint *l, cJSON *entities)
+{
+	cJSON *e, *other;
+	Prototype *p, *q;
+
+	for (e = entities->child ; e != NULL ; e = e->next)
+	{
+		p = findPrototype(getString(e, "type"));
+
+		for (other = e->next ; other != NULL && p != NULL ; other = other->next)
+		{
+			q = findPrototype(getString(other, "type"));
+
+			/* decorations and the like can be placed together, so only count solid things and duplicates */
+			if (q != NULL && ((p->entity.flags | q->entity.flags) & EF_SOLID || (p == q && getJSONIntVal(e, "x", 0) == getJSONIntVal(other, "x", 0) && getJSONIntVal(e, "y", 0) == getJSONIntVal(other, "y", 0))) && collision(getJSONIntVal(e, "x", 0), getJSONIntVal(e, "y", 0), p->entity.w, p->entity.h, getJSONIntVal(other, "x", 0), getJSONIntVal(other, "y", 0), q->entity.w, q->entity.h))
+			{
+				addProblem(l, "%s at %d,%d overlaps %s at %d,%d", p->id, getJSONIntVal(e, "x", 0), getJSONIntVal(e, "y", 0), q->id, getJSONIntVal(other, "x", 0), getJSONIntVal(other, "y", 0));
+			}
+		}
+	}
+}
+
+static void checkReachable(StageLint *l, LintMap *m, cJSON *entities, int clones)
+{
+	cJSON *e;
+	Prototype *p;
+	char *type;
+	int i, c, n, x, y;
+
+	p = findPrototype("player");
+
+	m->w = p->entity.w;
+	m->h = p->entity.h;
+
+	m->visited = malloc(((MAP_WIDTH * TILE_SIZE) / LINT_GROUND_CELL + 1) * (MAP_HEIGHT * TILE_SIZE));
+	memset(m->visited, 0, ((MAP_WIDTH * TILE_SIZE) / LINT_GROUND_CELL + 1) * (MAP_HEIGHT * TILE_SIZE));
+
+	for (e = entities->child ; e != NULL ; e = e->next)
+	{
+		addSurfaces(m, e);
+	}
+
+	qsort(m->surfaces, m->numSurfaces, sizeof(LintSurface), surfaceComparator);
+
+	for (e = entities->child ; e != NULL ; e = e->next)
+	{
+		if (strcmp(getString(e, "type"), "player") == 0)
+		{
+			x = getJSONIntVal(e, "x", 0);
+			y = getJSONIntVal(e, "y", 0);
+
+			touch(m, x, y, m->w, m->h);
+
+			/* dropped to the floor, as the stage does when it loads */
+			simulate(m, x, y, 0, 0, 0, 0);
+		}
+	}
+
+	for (i = 0 ; i < m->queueLength ; i++)
+	{
+		expandGround(m, m->queue[i]);
+	}
+
+	for (c = 0 ; c < clones ; c++)
+	{
+		n = m->queueLength;
+
+		for (i = 0 ; i < n ; i++)
+		{
+			standOnClone(m, m->queue[i]);
+		}
+
+		for (i = n ; i < m->queueLength ; i++)
+		{
+			expandGround(m, m->queue[i]);
+		}
+	}
+
+	for (e = entities->child ; e != NULL ; e = e->next)
+	{
+		type = getString(e, "type");
+
+		p = findPrototype(type);
+
+		if (p != NULL && isPickup(type) && !isTouched(m, getJSONIntVal(e, "x", 0), getJSONIntVal(e, "y", 0), p->entity.w, p->entity.h))
+		{
+			addProblem(l, "%s at %d,%d can't be reached", type, getJSONIntVal(e, "x", 0), getJSONIntVal(e, "y", 0));
+		}
+	}
+}
+
+/* as stage.map, to be sure that the same tiles are solid */
+static int loadMap(LintMap *m, cJSON *root)
+{
+	cJSON *map;
+	char *p;
+	int x, y;
+
+	map = cJSON_GetObjectItem(root, "map");
+
+	if (map == NULL || map->valuestring == NULL)
+	{
+		return 0;
+	}
+
+	p = map->valuestring;
+
+	for (y = 0 ; y < MAP_HEIGHT ; y++)
+	{
+		for (x = 0 ; x < MAP_WIDTH ; x++)
+		{
+			if (*p == '\0')
+			{
+				return 0;
+			}
+
+			m->solid[x][y] = atoi(p) != 0;
+
+			do {p++;} while (*p != ' ' && *p != '\0');
+		}
+	}
+
+	return 1;
+}
+
+/* the tops of anything solid, wherever it can be: a platform anywhere along its path, and a door open or shut */
+static void addSurfaces(LintMap *m, cJSON *e)
+{
+	Prototype *p;
+	char *type;
+	int x, y, sx, sy, ex, ey, i, n;
+
+	type = getString(e, "type");
+
+	p = findPrototype(type);
+
+	x = getJSONIntVal(e, "x", 0);
+	y = getJSONIntVal(e, "y", 0);
+
+	if (strcmp(type, "platform") == 0)
+	{
+		sx = getJSONIntVal(e, "sx", x);
+		sy = getJSONIntVal(e, "sy", y);
+		ex = getJSONIntVal(e, "ex", x);
+		ey = getJSONIntVal(e, "ey", y - 48);
+
+		n = MAX(MAX(abs(ex - sx), abs(ey - sy)) / LINT_PLATFORM_STEP, 1);
+
+		for (i = 0 ; i <= n ; i++)
+		{
+			addSurface(m, sx + ((ex - sx) * i / n), sy + ((ey - sy) * i / n), p->entity.w);
+		}
+	}
+	else if (p != NULL && (p->entity.flags & (EF_SOLID|EF_PUSHABLE)) == (EF_SOLID|EF_PUSHABLE))
+	{
+		addPushedSurface(m, x, y, p->entity.w, p->entity.h);
+	}
+	else if (p != NULL && p->entity.flags & EF_SOLID)
+	{
+		addSurface(m, x, y, p->entity.w);
+
+		if (strcmp(type, "door") == 0)
+		{
+			addSurface(m, x, y - (p->entity.h - 4), p->entity.w);
+		}
+	}
+}
+
+/* dropped to the floor, and then pushed anywhere along it that it fits, and off either end of it */
+static void addPushedSurface(LintMap *m, int x, int y, int w, int h)
+{
+	int mx, my, top, bottom, left, right;
+
+	mx = (x + w / 2) / TILE_SIZE;
+	my = (y + h - 1) / TILE_SIZE;
+
+	while (!isSolid(m, mx, my + 1))
+	{
+		my++;
+	}
+
+	top = (((my + 1) * TILE_SIZE) - h) / TILE_SIZE;
+	bottom = my;
+
+	left = right = mx;
+
+	while (isSolid(m, left - 1, bottom + 1) && !isSolid(m, left - 1, top) && !isSolid(m, left - 1, bottom))
+	{
+		left--;
+	}
+
+	while (isSolid(m, right + 1, bottom + 1) && !isSolid(m, right + 1, top) && !isSolid(m, right + 1, bottom))
+	{
+		right++;
+	}
+
+	addSurface(m, left * TILE_SIZE, ((my + 1) * TILE_SIZE) - h, ((right - left) + 1) * TILE_SIZE);
+
+	if (!isSolid(m, left - 1, bottom + 1) && !isSolid(m, left - 1, top) && !isSolid(m, left - 1, bottom))
+	{
+		addPushedSurface(m, (left - 1) * TILE_SIZE, ((my + 1) * TILE_SIZE) - h, w, h);
+	}
+
+	if (!isSolid(m, right + 1, bottom + 1) && !isSolid(m, right + 1, top) && !isSolid(m, right + 1, bottom))
+	{
+		addPushedSurface(m, (right + 1) * TILE_SIZE, ((my + 1) * TILE_SIZE) - h, w, h);
+	}
+}
+
+static void addSurface(LintMap *m, int x, int y, int w)
+{
+	int n;
+
+	if (m->numSurfaces == m->surfaceCapacity)
+	{
+		n = MAX(m->surfaceCapacity * 2, 64);
+
+		m->surfaces = resize(m->surfaces, sizeof(LintSurface) * m->surfaceCapacity, sizeof(LintSurface) * n);
+
+		m->surfaceCapacity = n;
+	}
+
+	m->surfaces[m->numSurfaces].x = x;
+	m->surfaces[m->numSurfaces].y = y;
+	m->surfaces[m->numSurfaces].w = w;
+
+	m->numSurfaces++;
+}
+
+static int surfaceComparator(const void *a, const void *b)
+{
+	return ((LintSurface*)a)->y - ((LintSurface*)b)->y;
+}
+
+/* the first surface at or below y, the surfaces being sorted top to bottom */
+static int findSurface(LintMap *m, float y)
+{
+	int low, high, mid;
+
+	low = 0;
+	high = m->numSurfaces;
+
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+
+		if (m->surfaces[mid].y < y)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+/* by value, as the queue can grow, and move, while it's being expanded */
+static void expandGround(LintMap *m, SDL_FPoint p)
+{
+	int i;
+
+	for (i = 0 ; i < (int)(sizeof(moves) / sizeof(moves[0])) ; i++)
+	{
+		simulate(m, p.x, p.y, moves[i][0], moves[i][1], moves[i][2], moves[i][3]);
+	}
+}
+
+/* a clone left standing at p, which is the player's size, with the player stood on its head */
+static void standOnClone(LintMap *m, SDL_FPoint p)
+{
+	int mx, my, y;
+
+	y = p.y - m->h;
+
+	if (y < 0)
+	{
+		return;
+	}
+
+	for (mx = p.x / TILE_SIZE ; mx <= (p.x + m->w - 1) / TILE_SIZE ; mx++)
+	{
+		for (my = y / TILE_SIZE ; my <= (p.y - 1) / TILE_SIZE ; my++)
+		{
+			if (isSolid(m, mx, my))
+			{
+				return;
+			}
+		}
+	}
+
+	touch(m, p.x, y, m->w, m->h);
+
+	addGround(m, p.x, y);
+}
+
+/* moves the box as the player would be, holding first for k frames and then second, until it lands */
+static void simulate(LintMap *m, float x, float y, float dy, int first, int k, int second)
+{
+	LintSurface *s;
+	float dx, feet;
+	int f, i, mx, my, onGround, cell[4], lastCell[4];
+
+	memset(lastCell, -1, sizeof(lastCell));
+
+	for (f = 0 ; f < LINT_MAX_FRAMES ; f++)
+	{
+		dx = (f < k ? first : second) * PLAYER_MOVE_SPEED;
+
+		dy = MIN(dy + 1.5, 18);
+
+		/* the same as moveToWorld */
+		if (dx != 0)
+		{
+			x += dx;
+
+			mx = (dx > 0 ? x + m->w : x) / TILE_SIZE;
+
+			if (isSolid(m, mx, y / TILE_SIZE) || isSolid(m, mx, (y + m->h - 1) / TILE_SIZE))
+			{
+				x = (mx * TILE_SIZE) + (dx > 0 ? -m->w : TILE_SIZE);
+			}
+		}
+
+		feet = y + m->h;
+
+		y += dy;
+
+		onGround = 0;
+
+		my = (dy > 0 ? y + m->h : y) / TILE_SIZE;
+
+		if (isSolid(m, x / TILE_SIZE, my) || isSolid(m, (x + m->w - 1) / TILE_SIZE, my))
+		{
+			y = (my * TILE_SIZE) + (dy > 0 ? -m->h : TILE_SIZE);
+
+			onGround = dy > 0;
+
+			dy = 0;
+		}
+		else if (dy > 0)
+		{
+			for (i = findSurface(m, feet) ; i < m->numSurfaces && m->surfaces[i].y <= y + m->h ; i++)
+			{
+				s = &m->surfaces[i];
+
+				if (x + m->w > s->x && x < s->x + s->w)
+				{
+					addGround(m, x, s->y - m->h);
+				}
+			}
+		}
+
+		/* the box covers the same cells until it crosses into a new one */
+		cell[0] = (int)x / LINT_TOUCH_SIZE;
+		cell[1] = (int)y / LINT_TOUCH_SIZE;
+		cell[2] = ((int)x + m->w - 1) / LINT_TOUCH_SIZE;
+		cell[3] = ((int)y + m->h - 1) / LINT_TOUCH_SIZE;
+
+		if (memcmp(cell, lastCell, sizeof(cell)) != 0)
+		{
+			touch(m, x, y, m->w, m->h);
+
+			memcpy(lastCell, cell, sizeof(cell));
+		}
+
+		if (onGround && f + 1 >= k)
+		{
+			addGround(m, x, y);
+
+			return;
+		}
+	}
+}
+
+/* somewhere the player can stand, to be expanded from if it's not been stood on before */
+static void addGround(LintMap *m, float x, float y)
+{
+	int i, n;
+
+	if (x < 0 || y < 0 || x >= MAP_WIDTH * TILE_SIZE || y >= MAP_HEIGHT * TILE_SIZE)
+	{
+		return;
+	}
+
+	i = ((int)x / LINT_GROUND_CELL) * (MAP_HEIGHT * TILE_SIZE) + (int)y;
+
+	if (m->visited[i])
+	{
+		return;
+	}
+
+	m->visited[i] = 1;
+
+	if (m->queueLength == m->queueCapacity)
+	{
+		n = MAX(m->queueCapacity * 2, 1024);
+
+		m->queue = resize(m->queue, sizeof(SDL_FPoint) * m->queueCapacity, sizeof(SDL_FPoint) * n);
+
+		m->queueCapacity = n;
+	}
+
+	m->queue[m->queueLength].x = x;
+	m->queue[m->queueLength].y = y;
+
+	m->queueLength++;
+}
+
+static int isSolid(LintMap *m, int mx, int my)
+{
+	return !isInsideMap(mx, my) || m->solid[mx][my];
+}
+
+static void touch(LintMap *m, int x, int y, int w, int h)
+{
+	int tx, ty;
+
+	for (tx = MAX(x, 0) / LINT_TOUCH_SIZE ; tx <= (x + w - 1) / LINT_TOUCH_SIZE && tx < (MAP_WIDTH * TILE_SIZE) / LINT_TOUCH_SIZE ; tx++)
+	{
+		for (ty = MAX(y, 0) / LINT_TOUCH_SIZE ; ty <= (y + h - 1) / LINT_TOUCH_SIZE && ty < (MAP_HEIGHT * TILE_SIZE) / LINT_TOUCH_SIZE ; ty++)
+		{
+			m->touched[tx][ty] = 1;
+		}
+	}
+}
+
+static int isTouched(LintMap *m, int x, int y, int w, int h)
+{
+	int tx, ty;
+
+	for (tx = MAX(x, 0) / LINT_TOUCH_SIZE ; tx <= (x + w - 1) / LINT_TOUCH_SIZE && tx < (MAP_WIDTH * TILE_SIZE) / LINT_TOUCH_SIZE ; tx++)
+	{
+		for (ty = MAX(y, 0) / LINT_TOUCH_SIZE ; ty <= (y + h - 1) / LINT_TOUCH_SIZE && ty < (MAP_HEIGHT * TILE_SIZE) / LINT_TOUCH_SIZE ; ty++)
+		{
+			if (m->touched[tx][ty])
+			{
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* the things a stage expects to be got to */
+static int isPickup(const char *type)
+{
+	return strcmp(type, "coin") == 0 || strcmp(type, "item") == 0 || strcmp(type, "key") == 0 || strcmp(type, "toilet") == 0 || strcmp(type, "finalToilet") == 0;
+}
+
+static char *getString(cJSON *e, const char *name)
+{
+	cJSON *node;
+
+	node = cJSON_GetObjectItem(e, name);
+
+	return node != NULL && node->valuestring != NULL ? node->valuestring : "";
+}
+
+static Prototype *findPrototype(const char *type)
+{
+	Prototype *p;
+	int i;
+
+	for (i = 0 ; (p = getStagePrototype(i)) != NULL ; i++)
+	{
+		if (strcmp(p->id, type) == 0)
+		{
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+/* a line of the stage's report, written out once every stage has been linted */
+static void addProblem(StageLint *l, const char *format, ...)
+{
+	char line[MAX_LINE_LENGTH];
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = vsnprintf(line, MAX_LINE_LENGTH - 1, format, args);
+	va_end(args);
+
+	n = MIN(n, MAX_LINE_LENGTH - 2);
+
+	line[n++] = '\n';
+	line[n] = '\0';
+
+	l->report = resize(l->report, l->reportLength + (l->reportLength > 0), l->reportLength + n + 1);
+
+	strcat(l->report, line);
+
+	l->reportLength += n;
+
+	l->problems++;
+}
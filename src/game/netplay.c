@@ -0,0 +1,369 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "netplay.h"
+#include <limits.h>
+#include "../system/controls.h"
+#include "../system/transport.h"
+#include "../world/rewind.h"
+#include "../world/snapshot.h"
+
+#define PULSE_CONTROLS    ((1 << CONTROL_USE) | (1 << CONTROL_RESTART))
+
+extern App app;
+extern Stage stage;
+
+static void receiveInputs(void);
+static void sendInputs(void);
+static int rollback(void (*tick)(void));
+static int simulate(void (*tick)(void), int frame);
+static int getLocalInput(void);
+static int getRemoteInput(int frame);
+static int isRestartConfirmed(void);
+
+static Snapshot states[NETPLAY_ROLLBACK_FRAMES + 1];
+static Uint16 localInputs[NETPLAY_HISTORY];
+static Uint16 remoteInputs[NETPLAY_HISTORY];
+static Uint16 usedInputs[NETPLAY_HISTORY];
+static int stageNum;
+static int attempt;
+static int current;
+static int confirmed;
+static int remoteAck;
+static int checked;
+static int rollbackFrom;
+static int restartRequested;
+
+/*
+ * Two-player co-op. The host's Walter is the player and the other is the partner, on both
+ * machines, so that both run exactly the same stage. Neither waits for the other's input:
+ * each frame is run straight away, guessing that the other player is still holding what
+ * they were last seen holding. Every frame's state is kept until the other's real input for
+ * it arrives, and if the guess was wrong, the stage is put back to that frame and run again
+ * up to the present. No more than NETPLAY_ROLLBACK_FRAMES are ever run on a guess.
+ */
+void startNetplay(int host)
+{
+	app.netplay.active = 1;
+	app.netplay.host = host;
+
+	/* only one player's controls would go into it */
+	app.replay.record = 0;
+
+	stageNum = -1;
+}
+
+/* called as each attempt at a stage is loaded, so that frames are counted from its start */
+void resetNetplay(void)
+{
+	if (stage.num == stageNum)
+	{
+		attempt++;
+	}
+	else
+	{
+		stageNum = stage.num;
+		attempt = 0;
+	}
+
+	current = 0;
+	confirmed = remoteAck = checked = -1;
+	rollbackFrom = INT_MAX;
+	restartRequested = 0;
+
+	app.netplay.waiting = 0;
+	app.dev.rollbackFrames = app.dev.rollbackCost = app.dev.netplayAhead = 0;
+}
+
+/* returns 1 if both players have agreed to restart the stage */
+int doNetplay(void (*tick)(void))
+{
+	Uint64 then;
+	int restarted;
+
+	receiveInputs();
+
+	then = SDL_GetPerformanceCounter();
+
+	app.dev.rollbackFrames = 0;
+
+	if (!rollback(tick))
+	{
+		return 0;
+	}
+
+	app.dev.rollbackCost = (SDL_GetPerformanceCounter() - then) * 1000000 / SDL_GetPerformanceFrequency();
+
+	restarted = isRestartConfirmed();
+
+	app.netplay.waiting = current - (confirmed + 1) >= NETPLAY_ROLLBACK_FRAMES;
+
+	if (!restarted && !app.netplay.waiting)
+	{
+		localInputs[current % NETPLAY_HISTORY] = getLocalInput();
+
+		if (!simulate(tick, current))
+		{
+			return 0;
+		}
+	}
+	else if (app.netplay.waiting)
+	{
+		app.dev.netplayStalls++;
+	}
+
+	app.dev.netplayAhead = current - (confirmed + 1);
+
+	sendInputs();
+
+	return restarted;
+}
+
+static void receiveInputs(void)
+{
+	NetplayPacket packet;
+	int i, n, count, frame, input;
+
+	while ((n = receivePacket(&packet, sizeof(NetplayPacket))) > 0)
+	{
+		/* a packet cut short would otherwise be read with whatever the last one left behind */
+		if (n < (int)(sizeof(NetplayPacket) - sizeof(packet.inputs)))
+		{
+			continue;
+		}
+
+		count = SDL_SwapLE32(packet.count);
+
+		if (count < 0 || count > NETPLAY_MAX_INPUTS || n < (int)(sizeof(NetplayPacket) - sizeof(packet.inputs) + sizeof(Uint16) * count))
+		{
+			continue;
+		}
+
+		if (memcmp(packet.magic, NETPLAY_MAGIC, 4) != 0 || SDL_SwapLE32(packet.stageNum) != stageNum || SDL_SwapLE32(packet.attempt) != attempt)
+		{
+			continue;
+		}
+
+		remoteAck = MAX(remoteAck, (int)SDL_SwapLE32(packet.ack));
+
+		frame = SDL_SwapLE32(packet.first);
+
+		for (i = 0 ; i < count ; i++, frame++)
+		{
+			/* taken strictly in order, so that anything lost is simply sent again */
+			if (frame == confirmed + 1)
+			{
+				input = SDL_SwapLE16(packet.inputs[i]);
+
+				remoteInputs[frame % NETPLAY_HISTORY] = input;
+
+				confirmed = frame;
+
+				if (frame < current && input != usedInputs[frame % NETPLAY_HISTORY])
+				{
+					rollbackFrom = MIN(rollbackFrom, frame);
+				}
+			}
+		}
+	}
+}
+
+/* everything the other player hasn't said they have, oldest first */
+static void sendInputs(void)
+{
+	NetplayPacket packet;
+	int i, first, count;
+
+	first = remoteAck + 1;
+	count = MIN(current - first, NETPLAY_MAX_INPUTS);
+
+	memcpy(packet.magic, NETPLAY_MAGIC, 4);
+	packet.stageNum = SDL_SwapLE32(stageNum);
+	packet.attempt = SDL_SwapLE32(attempt);
+	packet.ack = SDL_SwapLE32(confirmed);
+	packet.first = SDL_SwapLE32(first);
+	packet.count = SDL_SwapLE32(count);
+
+	for (i = 0 ; i < count ; i++)
+	{
+		packet.inputs[i] = SDL_SwapLE16(localInputs[(first + i) % NETPLAY_HISTORY]);
+	}
+
+	sendPacket(&packet, sizeof(NetplayPacket) - sizeof(packet.inputs) + sizeof(Uint16) * count);
+}
+
+/* puts the stage back to the first frame that was run on a wrong guess, and runs it up to now again */
+static int rollback(void (*tick)(void))
+{
+	int frame, slot;
+
+	if (rollbackFrom >= current)
+	{
+		return 1;
+	}
+
+	slot = rollbackFrom % (NETPLAY_ROLLBACK_FRAMES + 1);
+
+	restoreStage(&states[slot]);
+
+	/* this has all been seen and heard once already */
+	stage.skipEffects = stage.predicting = 1;
+
+	for (frame = rollbackFrom ; frame < current ; frame++)
+	{
+		if (!simulate(tick, frame))
+		{
+			break;
+		}
+
+		app.dev.rollbackFrames++;
+	}
+
+	stage.skipEffects = stage.predicting = 0;
+
+	rollbackFrom = INT_MAX;
+
+	return frame == current;
+}
+
+/* returns 0 if the frame took the stage somewhere else, after which the frames so far mean nothing */
+static int simulate(void (*tick)(void), int frame)
+{
+	int local, remote, slot, a;
+
+	slot = frame % (NETPLAY_ROLLBACK_FRAMES + 1);
+
+	captureStage(&states[slot]);
+
+	local = localInputs[frame % NETPLAY_HISTORY] & ~(1 << CONTROL_RESTART);
+
+	remote = getRemoteInput(frame);
+
+	usedInputs[frame % NETPLAY_HISTORY] = remote;
+
+	remote &= ~(1 << CONTROL_RESTART);
+
+	app.netplay.controls = app.netplay.host ? local : remote;
+
+	stage.partnerControls = app.netplay.host ? remote : local;
+
+	a = attempt;
+
+	app.netplay.ticking = 1;
+
+	tick();
+
+	app.netplay.ticking = 0;
+
+	if (stage.num != stageNum || attempt != a)
+	{
+		return 0;
+	}
+
+	current = MAX(current, frame + 1);
+
+	return 1;
+}
+
+static int getLocalInput(void)
+{
+	int controls, i;
+
+	controls = 0;
+
+	for (i = CONTROL_LEFT ; i <= CONTROL_RESTART ; i++)
+	{
+		if (i != CONTROL_CLONE && isControl(i))
+		{
+			controls |= 1 << i;
+		}
+	}
+
+	/* nothing is left to restart */
+	if (stage.status == SS_COMPLETE)
+	{
+		controls &= ~(1 << CONTROL_RESTART);
+	}
+
+	/* only sent for the frame they were pressed on */
+	clearControl(CONTROL_USE);
+	clearControl(CONTROL_RESTART);
+
+	if (restartRequested)
+	{
+		controls |= 1 << CONTROL_RESTART;
+
+		restartRequested = 0;
+	}
+
+	return controls;
+}
+
+/* the guess is that they're still holding whatever they held last */
+static int getRemoteInput(int frame)
+{
+	if (frame <= confirmed)
+	{
+		return remoteInputs[frame % NETPLAY_HISTORY];
+	}
+
+	if (confirmed >= 0)
+	{
+		return remoteInputs[confirmed % NETPLAY_HISTORY] & ~PULSE_CONTROLS;
+	}
+
+	return 0;
+}
+
+/* a restart is only acted on once both players know of it, which they will on the same frame */
+static int isRestartConfirmed(void)
+{
+	int frame;
+
+	for (frame = checked + 1 ; frame <= confirmed && frame < current ; frame++)
+	{
+		checked = frame;
+
+		if ((localInputs[frame % NETPLAY_HISTORY] | remoteInputs[frame % NETPLAY_HISTORY]) & (1 << CONTROL_RESTART))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void requestNetplayRestart(void)
+{
+	restartRequested = 1;
+}
+
+void destroyNetplay(void)
+{
+	int i;
+
+	for (i = 0 ; i < NETPLAY_ROLLBACK_FRAMES + 1 ; i++)
+	{
+		destroySnapshot(&states[i]);
+	}
+
+	closeTransport();
+}
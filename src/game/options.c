@@ -48,6 +48,8 @@ static Widget *jumpWidget;
 static Widget *useWidget;
 static Widget *cloneWidget;
 static Widget *restartWidget;
+static Widget *rewindWidget;
+static Widget *fastForwardWidget;
 static Widget *pauseWidget;
 static void (*oldDraw)(void);
 static void (*returnFromOptions)(void);
@@ -89,6 +91,8 @@ void initOptions(void (*done)(void))
 	useWidget = getWidget("use", "controls");
 	cloneWidget = getWidget("clone", "controls");
 	restartWidget = getWidget("restart", "controls");
+	rewindWidget = getWidget("rewind", "controls");
+	fastForwardWidget = getWidget("fastForward", "controls");
 	pauseWidget = getWidget("pause", "controls");
 
 	app.selectedWidget = getWidget("soundVolume", "options");
@@ -241,6 +245,8 @@ static void controls(void)
 	updateControlWidget(useWidget, CONTROL_USE);
 	updateControlWidget(cloneWidget, CONTROL_CLONE);
 	updateControlWidget(restartWidget, CONTROL_RESTART);
+	updateControlWidget(rewindWidget, CONTROL_REWIND);
+	updateControlWidget(fastForwardWidget, CONTROL_FAST_FORWARD);
 	updateControlWidget(pauseWidget, CONTROL_PAUSE);
 
 	showWidgets("controls", 1);
@@ -0,0 +1,313 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+#include "../common.h"
+#include "replay.h"
+#include <time.h>
+#include "../system/controls.h"
+#include "../system/io.h"
+#include "../system/util.h"
+#include "../world/stage.h"
+
+extern App app;
+extern Stage stage;
+
+static void addFrame(int controls);
+static void saveReplay(void);
+static void loadReplay(const char *filename);
+static unsigned int getBuildHash(void);
+
+static ReplayHeader header;
+static ReplayRun *runs;
+static int capacity;
+static int recording;
+static int runIndex;
+static int runFrame;
+
+/*
+ * With -record, each attempt at a stage is kept as the controls that were held on each of
+ * its frames, and written to the save dir when the stage ends. Everything else that happens
+ * follows from those and the stage's seed, so they're all that's needed to play it back.
+ */
+void startReplayRecording(void)
+{
+	recording = app.replay.record && !app.replay.playing;
+
+	if (recording)
+	{
+		memset(&header, 0, sizeof(ReplayHeader));
+		memcpy(header.magic, REPLAY_MAGIC, 4);
+		header.version = REPLAY_VERSION;
+		header.buildHash = getBuildHash();
+		header.stageNum = stage.num;
+		header.seed = stage.seed;
+	}
+}
+
+/* called as each frame of the stage begins, before anything looks at the controls */
+void doReplay(void)
+{
+	int controls, i;
+
+	if (app.replay.playing)
+	{
+		if (runIndex < header.numRuns)
+		{
+			app.replay.controls = runs[runIndex].controls;
+
+			if (++runFrame == runs[runIndex].length)
+			{
+				runIndex++;
+				runFrame = 0;
+			}
+		}
+		else
+		{
+			endReplay();
+		}
+	}
+	else if (recording)
+	{
+		controls = 0;
+
+		/* pausing would leave the replay sat in the menu, and fast-forwarding is already in the frame count */
+		for (i = 0 ; i < CONTROL_MAX ; i++)
+		{
+			if (i != CONTROL_PAUSE && i != CONTROL_FAST_FORWARD && isControl(i))
+			{
+				controls |= 1 << i;
+			}
+		}
+
+		addFrame(controls);
+	}
+}
+
+static void addFrame(int controls)
+{
+	ReplayRun *run;
+
+	run = header.numRuns > 0 ? &runs[header.numRuns - 1] : NULL;
+
+	if (run == NULL || run->controls != controls || run->length == 0xFFFF)
+	{
+		if (header.numRuns == capacity)
+		{
+			runs = resize(runs, sizeof(ReplayRun) * capacity, sizeof(ReplayRun) * MAX(capacity * 2, 256));
+
+			capacity = MAX(capacity * 2, 256);
+		}
+
+		run = &runs[header.numRuns++];
+		run->controls = controls;
+		run->length = 0;
+	}
+
+	run->length++;
+
+	header.numFrames++;
+}
+
+/* when the stage is left, however that happens */
+void endReplay(void)
+{
+	if (app.replay.playing)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Replay of stage %d ended: status %d, keys %d, coins %d / %d, items %d / %d, clones %d", stage.num, stage.status, stage.keys, stage.coins, stage.totalCoins, stage.items, stage.totalItems, stage.clones);
+
+		app.replay.playing = 0;
+		app.replay.controls = 0;
+	}
+
+	if (recording && header.numFrames > 0)
+	{
+		saveReplay();
+	}
+
+	recording = 0;
+}
+
+static void saveReplay(void)
+{
+	char filename[MAX_PATH_LENGTH];
+
+	sprintf(filename, "%s/stage%03d-%ld.replay", app.saveDir, header.stageNum, (long)time(NULL));
+
+	writeReplay(filename, header.stageNum, header.seed, runs, header.numRuns);
+}
+
+/* also for controls that weren't recorded from a player, such as the solver's */
+void writeReplay(const char *filename, int stageNum, unsigned int seed, ReplayRun *r, int numRuns)
+{
+	ReplayHeader h;
+	char *data;
+	int length, i;
+
+	memset(&h, 0, sizeof(ReplayHeader));
+	memcpy(h.magic, REPLAY_MAGIC, 4);
+	h.version = REPLAY_VERSION;
+	h.buildHash = getBuildHash();
+	h.stageNum = stageNum;
+	h.seed = seed;
+	h.numRuns = numRuns;
+
+	for (i = 0 ; i < numRuns ; i++)
+	{
+		h.numFrames += r[i].length;
+	}
+
+	length = sizeof(ReplayHeader) + sizeof(ReplayRun) * numRuns;
+
+	data = malloc(length);
+
+	memcpy(data, &h, sizeof(ReplayHeader));
+	memcpy(data + sizeof(ReplayHeader), r, sizeof(ReplayRun) * numRuns);
+
+	if (writeBinaryFile(filename, data, length))
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Saved replay '%s' (%d frames, %d runs)", filename, h.numFrames, numRuns);
+	}
+	else
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "Couldn't save replay '%s'", filename);
+	}
+
+	free(data);
+}
+
+/* takes over the controls of the stage that's already running, from its next frame, until the runs are used up */
+void playReplayRuns(ReplayRun *r, int numRuns)
+{
+	if (numRuns > capacity)
+	{
+		runs = resize(runs, sizeof(ReplayRun) * capacity, sizeof(ReplayRun) * numRuns);
+
+		capacity = numRuns;
+	}
+
+	memcpy(runs, r, sizeof(ReplayRun) * numRuns);
+
+	header.numRuns = numRuns;
+
+	runIndex = runFrame = 0;
+
+	app.replay.playing = 1;
+	app.replay.controls = 0;
+}
+
+/* starts the stage the replay was recorded on, with the controls taken from it rather than the player until it runs out */
+void playReplay(const char *filename)
+{
+	loadReplay(filename);
+
+	app.replay.playing = 1;
+	app.replay.controls = 0;
+
+	runIndex = runFrame = 0;
+
+	initStage();
+
+	stage.num = header.stageNum;
+	stage.seed = header.seed;
+
+	loadStage(1);
+}
+
+static void loadReplay(const char *filename)
+{
+	char *data;
+	int length;
+
+	data = readBinaryFile(filename, &length);
+
+	if (data == NULL || length < (int)sizeof(ReplayHeader) || memcmp(data, REPLAY_MAGIC, 4) != 0)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "'%s' is not a replay", filename);
+		exit(1);
+	}
+
+	memcpy(&header, data, sizeof(ReplayHeader));
+
+	if (header.version != REPLAY_VERSION || length != (int)(sizeof(ReplayHeader) + sizeof(ReplayRun) * header.numRuns))
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Replay '%s' is version %d, or is damaged", filename, header.version);
+		exit(1);
+	}
+
+	if (header.buildHash != getBuildHash())
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "Replay '%s' was recorded by a different build, and might not play out the same", filename);
+	}
+
+	capacity = MAX(header.numRuns, 1);
+
+	runs = realloc(runs, sizeof(ReplayRun) * capacity);
+
+	memcpy(runs, data + sizeof(ReplayHeader), sizeof(ReplayRun) * header.numRuns);
+
+	free(data);
+}
+
+/* plays the replay back as fast as it will go, without drawing anything, and exits */
+void runReplay(const char *filename)
+{
+	Uint64 start;
+	double ms;
+	int frames;
+
+	playReplay(filename);
+
+	frames = 0;
+
+	start = SDL_GetPerformanceCounter();
+
+	while (app.replay.playing && runIndex < header.numRuns)
+	{
+		app.delegate.logic();
+
+		frames++;
+	}
+
+	ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+	endReplay();
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Replayed %d frames (%d recorded) in %.1fms, %.4fms per frame", frames, header.numFrames, ms, ms / MAX(frames, 1));
+
+	exit(0);
+}
+
+/* anything that changes how the stage plays out should change this */
+static unsigned int getBuildHash(void)
+{
+	char build[MAX_DESCRIPTION_LENGTH];
+	unsigned int hash;
+	char *c;
+
+	sprintf(build, "%.1f.%d:%d:%d:%d", VERSION, REVISION, (int)sizeof(Entity), (int)sizeof(Stage), FPS);
+
+	hash = 2166136261u;
+
+	for (c = build ; *c != '\0' ; c++)
+	{
+		hash = (hash ^ (unsigned char)*c) * 16777619u;
+	}
+
+	return hash;
+}
@@ -0,0 +1,671 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "solver.h"
+#include "../game/replay.h"
+#include "../system/util.h"
+#include "../world/entityPool.h"
+#include "../world/map.h"
+#include "../world/rewind.h"
+#include "../world/snapshot.h"
+#include "../world/stage.h"
+
+extern App app;
+extern Stage stage;
+
+static int search(int clones);
+static void expand(int controls);
+static int addToFrontier(SolverNode *frontier, int n, int step);
+static int addStep(int parent, int controls);
+static ReplayRun *getPath(int step, int *numRuns);
+static void addRuns(ReplayRun *runs, int numRuns);
+static void restartStage(void);
+static int isPlayerAlive(void);
+static Entity *getSwitch(void);
+static int isSwitch(Entity *e);
+static float getScore(void);
+static int getPlayerTile(void);
+static void initTileDistances(void);
+static int visit(Uint64 hash);
+static Uint64 hashStage(void);
+static Uint64 hashValue(Uint64 hash, int value);
+static int getPlanFrames(void);
+
+/* held for SOLVER_STEP frames at a time */
+static int actions[] = {
+	0,
+	1 << CONTROL_LEFT,
+	1 << CONTROL_RIGHT,
+	1 << CONTROL_JUMP,
+	(1 << CONTROL_LEFT) | (1 << CONTROL_JUMP),
+	(1 << CONTROL_RIGHT) | (1 << CONTROL_JUMP),
+	1 << CONTROL_USE
+};
+
+static SolverNode nodes[2][SOLVER_BEAM];
+static SolverStep *steps;
+static int numSteps;
+static int stepCapacity;
+static ReplayRun *plan;
+static int numPlan;
+static int planCapacity;
+static Uint64 *visited;
+static int numVisited;
+static int visitedCapacity;
+static int numNodes;
+static int maxCoins;
+static int maxItems;
+static int tileDistances[MAP_WIDTH][MAP_HEIGHT];
+static Snapshot initialState;
+
+/*
+ * Looks for a way through a stage without anyone playing it, for checking that a stage can be
+ * done within its time and clone limits. From the start of an attempt, every one of actions is
+ * tried from every state in the frontier, by restoring the state and ticking the stage with the
+ * action held as a replay would hold it. States that have been reached before are dropped, and
+ * of the rest only the SOLVER_BEAM closest to a toilet are carried on with. If an attempt can't
+ * reach a toilet, a clone is made wherever the player first stood on each of the switches they
+ * reached, and the search starts again from the reset that follows. A solution is saved as a
+ * replay, so it can be watched with -replay.
+ *
+ * The stage is global, so the states are tried one at a time; stages are solved in parallel by
+ * running one -solve per stage. The stage is only loaded once, and each attempt starts from a
+ * capture of it, so nothing the search plays is saved as if someone had played it.
+ */
+void solveStage(int num)
+{
+	char filename[MAX_PATH_LENGTH];
+	Uint64 start;
+	int solved, i;
+
+	numNodes = maxCoins = maxItems = numPlan = 0;
+
+	start = SDL_GetPerformanceCounter();
+
+	app.headless = 1;
+
+	initStage();
+
+	stage.num = num;
+
+	loadStage(1);
+
+	stage.skipEffects = stage.predicting = 1;
+
+	captureStage(&initialState);
+
+	initTileDistances();
+
+	solved = search(0);
+
+	if (solved)
+	{
+		sprintf(filename, "%s/stage%03d-solution.replay", app.saveDir, num);
+
+		writeReplay(filename, num, stage.seed, plan, numPlan);
+
+		/* checked by playing it through from the start, as -replay would */
+		restartStage();
+
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, stage.status == SS_COMPLETE ? SDL_LOG_PRIORITY_INFO : SDL_LOG_PRIORITY_WARN, "Stage %d: solved in %d frames (time limit %ds) with %d of %d clones%s", num, getPlanFrames(), stage.timeLimit, stage.clones, stage.cloneLimit, stage.status == SS_COMPLETE ? "" : ", but the solution didn't play back");
+	}
+	else
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Stage %d: no solution found (time limit %ds, clone limit %d)", num, stage.timeLimit, stage.cloneLimit);
+	}
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Stage %d: coins reached %d / %d, items reached %d / %d, %d states tried in %.1fs", num, maxCoins, stage.totalCoins, maxItems, stage.totalItems, numNodes, (SDL_GetPerformanceCounter() - start) * 1.0 / SDL_GetPerformanceFrequency());
+
+	app.replay.playing = 0;
+
+	destroyStage();
+
+	destroySnapshot(&initialState);
+
+	for (i = 0 ; i < SOLVER_BEAM ; i++)
+	{
+		destroySnapshot(&nodes[0][i].state);
+		destroySnapshot(&nodes[1][i].state);
+	}
+
+	free(steps);
+	free(plan);
+	free(visited);
+
+	exit(0);
+}
+
+static int search(int clones)
+{
+	SolverNode *frontier, *next, *swap;
+	ReplayRun *points[SOLVER_CLONE_POINTS], *path, clone;
+	SDL_Point switches[SOLVER_CLONE_POINTS];
+	Entity *s;
+	int numFrontier, numNext, numPoints, numRuns[SOLVER_CLONE_POINTS], numPathRuns, planned, budget, step, solved, i, j, k;
+
+	restartStage();
+
+	numSteps = numVisited = numPoints = 0;
+
+	memset(visited, 0, sizeof(Uint64) * visitedCapacity);
+
+	frontier = nodes[0];
+	next = nodes[1];
+
+	captureStage(&frontier[0].state);
+	frontier[0].step = addStep(-1, 0);
+	numFrontier = 1;
+
+	visit(hashStage());
+
+	/* half of what's left is kept back for the attempts after a clone, if there can be any */
+	budget = clones < (int)stage.cloneLimit ? numNodes + (SOLVER_MAX_NODES - numNodes) / 2 : SOLVER_MAX_NODES;
+
+	while (numFrontier > 0 && numNodes < budget)
+	{
+		numNext = 0;
+
+		for (i = 0 ; i < numFrontier ; i++)
+		{
+			for (j = 0 ; j < (int)(sizeof(actions) / sizeof(int)) ; j++)
+			{
+				restoreStage(&frontier[i].state);
+
+				expand(actions[j]);
+
+				numNodes++;
+
+				maxCoins = MAX(maxCoins, stage.coins);
+				maxItems = MAX(maxItems, stage.items);
+
+				if (stage.status == SS_COMPLETE)
+				{
+					path = getPath(addStep(frontier[i].step, actions[j]), &numPathRuns);
+
+					addRuns(path, numPathRuns);
+
+					free(path);
+
+					for (k = 0 ; k < numPoints ; k++)
+					{
+						free(points[k]);
+					}
+
+					return 1;
+				}
+
+				if (stage.status == SS_INCOMPLETE && isPlayerAlive() && visit(hashStage()))
+				{
+					step = addStep(frontier[i].step, actions[j]);
+
+					numNext = addToFrontier(next, numNext, step);
+
+					s = getSwitch();
+
+					/* a clone left standing where the player first stood on a switch keeps it held */
+					if (s != NULL && numPoints < SOLVER_CLONE_POINTS && clones < (int)stage.cloneLimit)
+					{
+						k = 0;
+
+						while (k < numPoints && (switches[k].x != (int)s->x || switches[k].y != (int)s->y))
+						{
+							k++;
+						}
+
+						if (k == numPoints)
+						{
+							switches[numPoints].x = s->x;
+							switches[numPoints].y = s->y;
+							points[numPoints] = getPath(step, &numRuns[numPoints]);
+							numPoints++;
+						}
+					}
+				}
+			}
+		}
+
+		swap = frontier;
+		frontier = next;
+		next = swap;
+
+		numFrontier = numNext;
+	}
+
+	planned = numPlan;
+
+	clone.controls = 1 << CONTROL_CLONE;
+	clone.length = 1;
+
+	solved = 0;
+
+	for (i = 0 ; i < numPoints ; i++)
+	{
+		if (!solved)
+		{
+			addRuns(points[i], numRuns[i]);
+
+			addRuns(&clone, 1);
+
+			solved = search(clones + 1);
+
+			if (!solved)
+			{
+				numPlan = planned;
+			}
+		}
+
+		free(points[i]);
+	}
+
+	return solved;
+}
+
+static void expand(int controls)
+{
+	ReplayRun run;
+	int i;
+
+	run.controls = controls;
+	run.length = SOLVER_STEP;
+
+	playReplayRuns(&run, 1);
+
+	for (i = 0 ; i < SOLVER_STEP && stage.status == SS_INCOMPLETE ; i++)
+	{
+		tickStage();
+	}
+}
+
+/*
+ * Once the frontier is full, a state only gets in by pushing out the one furthest from a toilet.
+ * No more than SOLVER_TILE_STATES are kept for any one tile, or the whole frontier could end up
+ * piled against a wall that's closest to a toilet as the crow flies, but not as Walter jumps.
+ */
+static int addToFrontier(SolverNode *frontier, int n, int step)
+{
+	float score;
+	int i, tile, same, worst, worstSame;
+
+	score = getScore();
+
+	tile = getPlayerTile();
+
+	same = 0;
+
+	worst = worstSame = -1;
+
+	for (i = 0 ; i < n ; i++)
+	{
+		if (frontier[i].tile == tile)
+		{
+			same++;
+
+			if (worstSame == -1 || frontier[i].score > frontier[worstSame].score)
+			{
+				worstSame = i;
+			}
+		}
+
+		if (worst == -1 || frontier[i].score > frontier[worst].score)
+		{
+			worst = i;
+		}
+	}
+
+	if (same >= SOLVER_TILE_STATES)
+	{
+		worst = worstSame;
+	}
+	else if (n < SOLVER_BEAM)
+	{
+		worst = -1;
+	}
+
+	if (worst == -1)
+	{
+		worst = n++;
+	}
+	else if (frontier[worst].score <= score)
+	{
+		return n;
+	}
+
+	captureStage(&frontier[worst].state);
+	frontier[worst].step = step;
+	frontier[worst].score = score;
+	frontier[worst].tile = tile;
+
+	return n;
+}
+
+static int addStep(int parent, int controls)
+{
+	int n;
+
+	if (numSteps == stepCapacity)
+	{
+		n = MAX(stepCapacity * 2, 1024);
+
+		steps = resize(steps, sizeof(SolverStep) * stepCapacity, sizeof(SolverStep) * n);
+
+		stepCapacity = n;
+	}
+
+	steps[numSteps].parent = parent;
+	steps[numSteps].controls = controls;
+
+	return numSteps++;
+}
+
+/* the controls held from the start of the attempt to step, the first step being the start itself */
+static ReplayRun *getPath(int step, int *numRuns)
+{
+	ReplayRun *runs;
+	int i, n;
+
+	n = 0;
+
+	for (i = step ; steps[i].parent != -1 ; i = steps[i].parent)
+	{
+		n++;
+	}
+
+	runs = malloc(sizeof(ReplayRun) * MAX(n, 1));
+
+	*numRuns = n;
+
+	for (i = step ; steps[i].parent != -1 ; i = steps[i].parent)
+	{
+		n--;
+
+		runs[n].controls = steps[i].controls;
+		runs[n].length = SOLVER_STEP;
+	}
+
+	return runs;
+}
+
+static void addRuns(ReplayRun *runs, int numRuns)
+{
+	int n;
+
+	if (numPlan + numRuns > planCapacity)
+	{
+		n = MAX(planCapacity * 2, numPlan + numRuns);
+
+		plan = resize(plan, sizeof(ReplayRun) * planCapacity, sizeof(ReplayRun) * n);
+
+		planCapacity = n;
+	}
+
+	memcpy(plan + numPlan, runs, sizeof(ReplayRun) * numRuns);
+
+	numPlan += numRuns;
+}
+
+/* from the very beginning, with the clones that have been made so far made again */
+static void restartStage(void)
+{
+	int i, frames;
+
+	app.replay.playing = 0;
+
+	stage.clones = 0;
+
+	restoreStage(&initialState);
+
+	frames = getPlanFrames();
+
+	playReplayRuns(plan, numPlan);
+
+	for (i = 0 ; i < frames ; i++)
+	{
+		tickStage();
+	}
+}
+
+static int isPlayerAlive(void)
+{
+	Entity *player;
+
+	player = getPlayer();
+
+	return player != NULL && player->health > 0;
+}
+
+/* whichever switch the player is on; switches are told apart by where they are, which holds across restores and restarts */
+static Entity *getSwitch(void)
+{
+	Entity *player, *e;
+
+	player = getPlayer();
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		if (isSwitch(e) && collision(player->x, player->y, player->w, player->h + 2, e->x, e->y - 2, e->w, e->h + 2))
+		{
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+/* anything that names a target */
+static int isSwitch(Entity *e)
+{
+	int i;
+
+	for (i = 0 ; i < e->def->numFields ; i++)
+	{
+		if (strcmp(e->def->fields[i].name, "targetName") == 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* lower is better: how many tiles the player is from a toilet, less something for every key they have */
+static float getScore(void)
+{
+	int tile;
+
+	tile = getPlayerTile();
+
+	return (tile != -1 ? tileDistances[tile / MAP_HEIGHT][tile % MAP_HEIGHT] : MAP_WIDTH * MAP_HEIGHT) - stage.keys * 8;
+}
+
+/* -1 if off the map */
+static int getPlayerTile(void)
+{
+	Entity *player;
+	int mx, my;
+
+	player = getPlayer();
+
+	mx = (player->x + player->w / 2) / TILE_SIZE;
+	my = (player->y + player->h / 2) / TILE_SIZE;
+
+	return isInsideMap(mx, my) ? mx * MAP_HEIGHT + my : -1;
+}
+
+/*
+ * The number of tiles between each empty tile and the nearest toilet, going around walls
+ * rather than through them. Jumping isn't taken into account, but it's a far better guide
+ * through a maze than a straight line.
+ */
+static void initTileDistances(void)
+{
+	SDL_Point *queue, *p;
+	Entity *e;
+	int head, tail, mx, my, i;
+	int neighbours[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+	for (mx = 0 ; mx < MAP_WIDTH ; mx++)
+	{
+		for (my = 0 ; my < MAP_HEIGHT ; my++)
+		{
+			tileDistances[mx][my] = MAP_WIDTH * MAP_HEIGHT;
+		}
+	}
+
+	queue = malloc(sizeof(SDL_Point) * MAP_WIDTH * MAP_HEIGHT);
+
+	head = tail = 0;
+
+	for (e = stage.typeHead[ET_TOILET] ; e != NULL ; e = e->typeNext)
+	{
+		mx = (e->x + e->w / 2) / TILE_SIZE;
+		my = (e->y + e->h / 2) / TILE_SIZE;
+
+		if (isInsideMap(mx, my) && tileDistances[mx][my] != 0)
+		{
+			tileDistances[mx][my] = 0;
+
+			queue[tail].x = mx;
+			queue[tail].y = my;
+			tail++;
+		}
+	}
+
+	while (head < tail)
+	{
+		p = &queue[head++];
+
+		for (i = 0 ; i < 4 ; i++)
+		{
+			mx = p->x + neighbours[i][0];
+			my = p->y + neighbours[i][1];
+
+			if (isInsideMap(mx, my) && stage.map[mx][my] == 0 && tileDistances[mx][my] > tileDistances[p->x][p->y] + 1)
+			{
+				tileDistances[mx][my] = tileDistances[p->x][p->y] + 1;
+
+				queue[tail].x = mx;
+				queue[tail].y = my;
+				tail++;
+			}
+		}
+	}
+
+	free(queue);
+}
+
+/* 0 if the state has been reached before */
+static int visit(Uint64 hash)
+{
+	Uint64 *old;
+	int i, n;
+
+	if (numVisited * 2 >= visitedCapacity)
+	{
+		old = visited;
+		n = visitedCapacity;
+
+		visitedCapacity = MAX(visitedCapacity * 2, 4096);
+		visited = malloc(sizeof(Uint64) * visitedCapacity);
+		memset(visited, 0, sizeof(Uint64) * visitedCapacity);
+
+		numVisited = 0;
+
+		for (i = 0 ; i < n ; i++)
+		{
+			if (old[i] != 0)
+			{
+				visit(old[i]);
+			}
+		}
+
+		free(old);
+	}
+
+	/* 0 marks an empty slot */
+	hash = MAX(hash, 1);
+
+	for (i = hash & (visitedCapacity - 1) ; visited[i] != 0 ; i = (i + 1) & (visitedCapacity - 1))
+	{
+		if (visited[i] == hash)
+		{
+			return 0;
+		}
+	}
+
+	visited[i] = hash;
+
+	numVisited++;
+
+	return 1;
+}
+
+/* to within SOLVER_CELL pixels, as states that only differ by a few of them play out much the same */
+static Uint64 hashStage(void)
+{
+	Entity *e;
+	Uint64 hash;
+
+	hash = 14695981039346656037ULL;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		hash = hashValue(hash, e->x / SOLVER_CELL);
+		hash = hashValue(hash, e->y / SOLVER_CELL);
+		hash = hashValue(hash, e->dx);
+		hash = hashValue(hash, e->dy / 4);
+		hash = hashValue(hash, e->health);
+		hash = hashValue(hash, e->state);
+		hash = hashValue(hash, e->isOnGround);
+	}
+
+	hash = hashValue(hash, stage.keys);
+	hash = hashValue(hash, stage.items);
+	hash = hashValue(hash, stage.coins);
+	hash = hashValue(hash, stage.projectiles.count);
+
+	return hash;
+}
+
+static Uint64 hashValue(Uint64 hash, int value)
+{
+	int i;
+
+	for (i = 0 ; i < 4 ; i++)
+	{
+		hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static int getPlanFrames(void)
+{
+	int i, frames;
+
+	frames = 0;
+
+	for (i = 0 ; i < numPlan ; i++)
+	{
+		frames += plan[i].length;
+	}
+
+	return frames;
+}
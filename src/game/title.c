@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../world/stage.h"
 #include "../system/text.h"
 #include "../world/entities.h"
+#include "../world/entityPool.h"
 #include "../system/draw.h"
 #include "../game/story.h"
 
@@ -60,6 +61,8 @@ static Widget *previousWidget;
 
 void initTitle(void)
 {
+	Entity *player;
+
 	waterTexture = getAtlasImage("gfx/main/water.png", 1);
 	closetTexture = getAtlasImage("gfx/main/closet.png", 1);
 
@@ -92,9 +95,11 @@ void initTitle(void)
 
 	loadStage(0);
 
-	stage.player->atlasImage = getAtlasImage("gfx/entities/guyPlunger.png", 1);
+	player = getPlayer();
+
+	player->atlasImage = getAtlasImage("gfx/entities/guyPlunger.png", 1);
 
-	stage.player->tick = NULL;
+	player->state = PS_FROZEN;
 
 	previousWidget = NULL;
 
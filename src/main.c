@@ -28,10 +28,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "system/init.h"
 #include "world/stage.h"
 #include "game/ending.h"
+#include "game/benchmark.h"
+#include "game/replay.h"
+#include "game/solver.h"
+#include "game/linter.h"
+#include "game/netplay.h"
+#include "system/transport.h"
+#include "world/entitySerialiser.h"
 
 App app;
 Entity *player;
-Entity *self;
+_Thread_local Entity *self;
 Game game;
 Stage stage;
 
@@ -117,6 +124,55 @@ static void handleCommandLine(int argc, char *argv[])
 
 			stage.num = -1;
 		}
+		else if (strcmp(argv[i], "-benchmark") == 0)
+		{
+			runBenchmark(atoi(argv[i + 1]), atoi(argv[i + 2]));
+		}
+		else if (strcmp(argv[i], "-solve") == 0)
+		{
+			solveStage(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-compileStages") == 0)
+		{
+			compileStages();
+		}
+		else if (strcmp(argv[i], "-lint") == 0)
+		{
+			lintStages();
+		}
+		else if (strcmp(argv[i], "-replay") == 0)
+		{
+			playReplay(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-runReplay") == 0)
+		{
+			runReplay(argv[i + 1]);
+		}
+
+		/* co-op has to be set up before the stage is loaded */
+		if (strcmp(argv[i], "-host") == 0)
+		{
+			initUDPTransport(NULL, atoi(argv[i + 1]));
+
+			startNetplay(1);
+		}
+		else if (strcmp(argv[i], "-join") == 0)
+		{
+			initUDPTransport(argv[i + 1], atoi(argv[i + 2]));
+
+			startNetplay(0);
+		}
+		else if (strcmp(argv[i], "-loopback") == 0)
+		{
+			initLoopbackTransport(atoi(argv[i + 1]));
+
+			startNetplay(1);
+		}
+
+		if (strcmp(argv[i], "-record") == 0)
+		{
+			app.replay.record = 1;
+		}
 
 		if (strcmp(argv[i], "-debug") == 0)
 		{
@@ -33,6 +33,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "world/entities.h"
 #include "system/draw.h"
 #include "world/entityFactory.h"
+#include "world/entityPool.h"
+#include "world/entitySerialiser.h"
 
 #include <SDL2/SDL_ttf.h>
 #include <dirent.h>
@@ -49,7 +51,7 @@ enum
 
 App app;
 Entity *player;
-Entity *self;
+_Thread_local Entity *self;
 Game game;
 Stage stage;
 
@@ -136,23 +138,9 @@ static void saveEntities(cJSON *root)
 
 	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
 	{
-		self = e;
-
 		entityJSON = cJSON_CreateObject();
 
-		cJSON_AddStringToObject(entityJSON, "type", e->typeName);
-		cJSON_AddNumberToObject(entityJSON, "x", e->x);
-		cJSON_AddNumberToObject(entityJSON, "y", e->y);
-
-		if (strlen(e->name) > 0)
-		{
-			cJSON_AddStringToObject(entityJSON, "name", e->name);
-		}
-
-		if (e->save)
-		{
-			e->save(entityJSON);
-		}
+		writeEntityJSON(e, entityJSON);
 
 		cJSON_AddItemToArray(entitiesJSON, entityJSON);
 	}
@@ -208,6 +196,13 @@ static void saveStage(void)
 
 	free(out);
 
+	/* compiled from the file as written, so the game can tell it's up to date */
+	out = readFile(filename);
+
+	compileEntities(out);
+
+	free(out);
+
 	printf("Saved %s\n", filename);
 #ifdef _WIN32
 	fflush(stdout);
@@ -225,7 +220,7 @@ static void createEntity(void)
 	x += stage.camera.x;
 	y += stage.camera.y;
 
-	e = spawnEditorEntity(entity->typeName, x, y);
+	e = spawnEditorEntity(entity->def->typeName, x, y);
 
 	addToQuadtree(e, &stage.quadtree);
 }
@@ -249,13 +244,15 @@ static void deleteEntity(void)
 
 			removeFromQuadtree(e, &stage.quadtree);
 
+			removeFromTypeList(e);
+
 			/* loaded, so safe to delete */
 			if (e->id != -1)
 			{
-				free(e->data);
+				freeComponent(e->data);
 			}
 
-			free(e);
+			freeEntity(e);
 
 			e = prev;
 		}
@@ -327,7 +324,7 @@ static void toggleSelectEntity(void)
 
 		addToQuadtree(selectedEntity, &stage.quadtree);
 
-		if (strcmp(selectedEntity->typeName, "platform") == 0)
+		if (strcmp(selectedEntity->def->typeName, "platform") == 0)
 		{
 			p = (Platform*)selectedEntity->data;
 
@@ -371,7 +368,7 @@ static void logic(void)
 			case MODE_TILE:
 				x = (app.mouse.x + stage.camera.x) / TILE_SIZE;
 				y = (app.mouse.y + stage.camera.y) / TILE_SIZE;
-				stage.map[x][y] = tile;
+				setMapTile(x, y, tile);
 				break;
 
 			case MODE_ENT:
@@ -393,7 +390,7 @@ static void logic(void)
 			case MODE_TILE:
 				x = (app.mouse.x + stage.camera.x) / TILE_SIZE;
 				y = (app.mouse.y + stage.camera.y) / TILE_SIZE;
-				stage.map[x][y] = 0;
+				setMapTile(x, y, 0);
 				break;
 
 			case MODE_ENT:
@@ -496,20 +493,13 @@ static void logic(void)
 static void drawCurrentTile(void)
 {
 	int x, y;
-	SDL_Rect r;
 
 	x = (app.mouse.x / TILE_SIZE) * TILE_SIZE;
 	y = (app.mouse.y / TILE_SIZE) * TILE_SIZE;
 
 	blitAtlasImage(stage.tiles[tile], x, y, 0, SDL_FLIP_NONE);
 
-	r.x = x;
-	r.y = y;
-	r.w = TILE_SIZE;
-	r.h = TILE_SIZE;
-
-	SDL_SetRenderDrawColor(app.renderer, 255, 255, 0, 255);
-	SDL_RenderDrawRect(app.renderer, &r);
+	drawOutlineRect(x, y, TILE_SIZE, TILE_SIZE, 255, 255, 0, 255);
 }
 
 static void drawCurrentEnt(void)
@@ -631,7 +621,7 @@ static void centreOnPlayer(void)
 
 	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
 	{
-		if (e->type == ET_PLAYER)
+		if (e->def->type == ET_PLAYER)
 		{
 			stage.camera.x = e->x;
 			stage.camera.y = e->y;
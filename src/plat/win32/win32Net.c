@@ -0,0 +1,135 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../../common.h"
+#include "win32Net.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+static SOCKET sock = INVALID_SOCKET;
+static struct sockaddr_storage peer;
+static int peerLength;
+
+/* a non-blocking UDP socket. With no host, it waits on port for whoever sends first */
+int openSocket(const char *host, int port)
+{
+	struct addrinfo hints, *info;
+	struct sockaddr_in addr;
+	u_long nonBlocking;
+	WSADATA wsaData;
+	char service[16];
+
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		return 0;
+	}
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (sock == INVALID_SOCKET)
+	{
+		return 0;
+	}
+
+	nonBlocking = 1;
+
+	ioctlsocket(sock, FIONBIO, &nonBlocking);
+
+	peerLength = 0;
+
+	if (host == NULL)
+	{
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+		addr.sin_port = htons(port);
+
+		return bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	sprintf(service, "%d", port);
+
+	if (getaddrinfo(host, service, &hints, &info) != 0)
+	{
+		return 0;
+	}
+
+	memcpy(&peer, info->ai_addr, info->ai_addrlen);
+	peerLength = info->ai_addrlen;
+
+	freeaddrinfo(info);
+
+	return 1;
+}
+
+int sendSocket(void *data, int length)
+{
+	if (peerLength == 0)
+	{
+		return 0;
+	}
+
+	return sendto(sock, data, length, 0, (struct sockaddr*)&peer, peerLength) == length;
+}
+
+int receiveSocket(void *data, int length)
+{
+	struct sockaddr_storage from;
+	int fromLength, n;
+
+	/* anything from elsewhere is dropped, and the next one looked at, as 0 means there's nothing left to read */
+	do
+	{
+		fromLength = sizeof(from);
+
+		n = recvfrom(sock, data, length, 0, (struct sockaddr*)&from, &fromLength);
+
+		if (n <= 0)
+		{
+			return 0;
+		}
+
+		/* the first to get in touch is the peer from then on */
+		if (peerLength == 0)
+		{
+			memcpy(&peer, &from, fromLength);
+			peerLength = fromLength;
+		}
+	}
+	while (fromLength != peerLength || memcmp(&from, &peer, fromLength) != 0);
+
+	return n;
+}
+
+void closeSocket(void)
+{
+	if (sock != INVALID_SOCKET)
+	{
+		closesocket(sock);
+
+		sock = INVALID_SOCKET;
+
+		WSACleanup();
+	}
+}
@@ -20,14 +20,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 typedef struct Texture Texture;
 typedef struct Entity Entity;
+typedef struct EntityDef EntityDef;
 typedef struct Quadtree Quadtree;
-typedef struct InitFunc InitFunc;
+typedef struct Prototype Prototype;
 typedef struct Particle Particle;
-typedef struct CloneData CloneData;
+typedef struct Recording Recording;
 typedef struct cJSON cJSON;
 typedef struct StageMeta StageMeta;
 typedef struct AtlasImage AtlasImage;
 typedef struct Lookup Lookup;
+typedef struct Pool Pool;
+typedef struct PoolBlock PoolBlock;
 typedef struct Widget Widget;
 typedef struct Credit Credit;
 
@@ -43,12 +46,6 @@ struct Lookup {
 	Lookup *next;
 };
 
-struct InitFunc {
-	char id[MAX_NAME_LENGTH];
-	void (*init)(Entity *e);
-	InitFunc *next;
-};
-
 struct AtlasImage {
 	char filename[MAX_DESCRIPTION_LENGTH];
 	SDL_Texture *texture;
@@ -56,44 +53,236 @@ struct AtlasImage {
 	AtlasImage *next;
 };
 
-struct Entity {
-	unsigned long id;
-	unsigned int type;
-	char *typeName;
+/* sits in front of every pooled item; next is only used while the block is free */
+struct PoolBlock {
+	Pool *pool;
+	PoolBlock *next;
+	int index;
+	unsigned int generation;
+};
+
+struct Pool {
 	char name[MAX_NAME_LENGTH];
+	int itemSize;
+	int blockSize;
+	int perSlab;
+	int capacity;
+	int live;
+	int peak;
+	SDL_SpinLock lock;
+	char **slabs;
+	int numSlabs;
+	PoolBlock *freeList;
+};
+
+/* frames played against stage.frame; with no frames, the entity's own image is shown */
+typedef struct {
+	int numFrames;
+	AtlasImage *frames[MAX_ANIM_FRAMES];
+	int durations[MAX_ANIM_FRAMES];
+	int length;
+	int loop;
+	float bob;
+} AnimClip;
+
+/* a reference to an entity that is safe to keep after it dies; generation 0 is no entity */
+typedef struct {
+	int index;
+	unsigned int generation;
+} EntityHandle;
+
+/* a value a stage gives an entity, found at offset in its component, or on the entity itself for FT_FACING */
+typedef struct {
+	char *name;
+	int type;
+	int offset;
+} EntityField;
+
+/* behaviour shared by every entity of a type */
+struct EntityDef {
+	char *typeName;
+	unsigned int type;
+	void (*tick)(void);
+	void (*touch)(Entity *other);
+	void (*activate)(int active);
+	void (*die)(void);
+	void (*load)(void);
+	EntityField *fields;
+	int numFields;
+	void (*hit)(int projectileType);
+	int tileLayer;
+	int updateGroup;
+};
+
+/* fields touched every frame by the update come first, so they share a cache line */
+struct Entity {
 	float x;
 	float y;
 	int w;
 	int h;
-	int facing;
 	float dx;
 	float dy;
+	long flags;
 	int health;
 	int isOnGround;
+	int state;
+	EntityDef *def;
+	EntityHandle riding;
+	Entity *next;
+	int facing;
 	int background;
-	void (*data);
 	AtlasImage *atlasImage;
+	AnimClip *anim;
+	int animStart;
+	void (*data);
+	unsigned long id;
+	char name[MAX_NAME_LENGTH];
 	struct {
 		int x, y;
 		int r, g, b, a;
 		int foreground;
 	} light;
-	void (*init)(void);
-	void (*tick)(void);
-	void (*touch)(Entity *other);
-	void (*activate)(int active);
-	void (*die)(void);
-	void (*load)(cJSON *root);
-	void (*save)(cJSON *root);
-	long flags;
-	Entity *riding;
-	Entity *next;
+	Entity *typePrev;
+	Entity *typeNext;
+};
+
+/* a SnapshotHeader, then each entity's SnapshotRecord, Entity and component data, then the order the quadtree holds them in */
+typedef struct {
+	char *data;
+	int size;
+	int capacity;
+} Snapshot;
+
+typedef struct {
+	int numEnts;
+	int numOrdered;
+	int totalKeys;
+	int totalItems;
+	int totalCoins;
+	unsigned long entityId;
+} SnapshotHeader;
+
+typedef struct {
+	int componentType;
+	int componentSize;
+	int riding;
+	int dead;
+} SnapshotRecord;
+
+/* what a rewind puts back besides the entities, stored after them and the live projectiles */
+typedef struct {
+	int frame;
+	int keys;
+	int coins;
+	int items;
+	unsigned int time;
+	int status;
+	int nextStageTimer;
+	int numProjectiles;
+	int entitiesSize;
+	unsigned int stats[STAT_MAX];
+} RewindState;
+
+/* a keyframe is a whole frame, anything else is a list of RewindSpans against the frame before */
+typedef struct {
+	int offset;
+	int size;
+	int length;
+	int keyframe;
+} RewindFrame;
+
+/* length bytes, following this, that go at offset */
+typedef struct {
+	int offset;
+	int length;
+} RewindSpan;
+
+/* where an entity was every PREDICTION_STEP frames of a look-ahead */
+typedef struct {
+	unsigned long id;
+	int type;
+	int numPoints;
+	SDL_Point points[PREDICTION_FRAMES / PREDICTION_STEP + 1];
+} PredictionTrail;
+
+/* a state the solver has reached, kept while it's in the frontier */
+typedef struct {
+	Snapshot state;
+	int step;
+	int tile;
+	float score;
+} SolverNode;
+
+/* how the solver reached a state: the state before it, and what was held for SOLVER_STEP frames */
+typedef struct {
+	int parent;
+	int controls;
+} SolverStep;
+
+/* one instance of a stage being played by an agent, kept while another instance has the stage */
+typedef struct {
+	Snapshot state;
+	Recording *recording;
+	unsigned int clones;
+	int done;
+} Env;
+
+/*
+ * Instances of the same stage, stepped together. What each one sees is written straight into
+ * the arrays here, indexed by instance, for the agent to read in place. The tiles don't change
+ * while a stage is played, so they're shared.
+ */
+typedef struct {
+	int stageNum;
+	int numEnvs;
+	Env *envs;
+	Snapshot start;
+	unsigned char tiles[MAP_WIDTH * MAP_HEIGHT];
+	float *entities;
+	int *numEntities;
+	float *rewards;
+	int *dones;
+	char *pool;
+} EnvBatch;
+
+/* a stage being linted, read in before the stages are shared out between the job threads */
+typedef struct {
+	int num;
+	char *json;
+	char *report;
+	int reportLength;
+	int problems;
+} StageLint;
+
+/* the top of a platform, somewhere along its path */
+typedef struct {
+	int x, y, w;
+} LintSurface;
+
+/* the tiles and platforms a lint moves the player around, and everywhere it got to */
+typedef struct {
+	int solid[MAP_WIDTH][MAP_HEIGHT];
+	unsigned char touched[(MAP_WIDTH * TILE_SIZE) / LINT_TOUCH_SIZE][(MAP_HEIGHT * TILE_SIZE) / LINT_TOUCH_SIZE];
+	unsigned char *visited;
+	SDL_FPoint *queue;
+	int queueLength;
+	int queueCapacity;
+	LintSurface *surfaces;
+	int numSurfaces;
+	int surfaceCapacity;
+	int w, h;
+} LintMap;
+
+/* an entity as every instance of its type starts out, with its images already looked up */
+struct Prototype {
+	char id[MAX_NAME_LENGTH];
+	Entity entity;
+	void (*init)(Entity *e);
+	Prototype *next;
 };
 
 typedef struct {
-	int animTimer;
 	int requiresPlunger;
-	int frameNum;
 } Toilet;
 
 typedef struct {
@@ -117,16 +306,11 @@ typedef struct {
 	int open;
 } Door;
 
-typedef struct {
-	float bobValue;
-} Collectable;
-
 typedef struct {
 	char textureFilename[MAX_NAME_LENGTH];
 } Decoration;
 
 typedef struct {
-	float bobValue;
 	char textureFilename[MAX_NAME_LENGTH];
 } Item;
 
@@ -138,11 +322,13 @@ typedef struct {
 
 typedef struct {
 	int on;
+	int target;
 	char targetName[MAX_NAME_LENGTH];
 } TrafficLight;
 
 typedef struct {
 	int weight;
+	int target;
 	char targetName[MAX_NAME_LENGTH];
 } PressurePlate;
 
@@ -151,25 +337,122 @@ typedef struct {
 	int inflated;
 	int emptyRate;
 	int emptyTimer;
+	int target;
 	char targetName[MAX_NAME_LENGTH];
 } WaterButton;
 
-struct CloneData {
+/* everything a switch can activate under one name */
+typedef struct {
+	char name[MAX_NAME_LENGTH];
+	EntityHandle *ents;
+	int numEnts;
+	int capacity;
+} Target;
+
+/* consecutive recorded frames with the same dx and action, over which dy changes by a fixed step */
+typedef struct {
 	int frame;
+	int length;
 	float dx;
 	float dy;
+	float ddy;
 	int action;
-	CloneData *next;
+} CloneRun;
+
+typedef struct {
+	float dx;
+	float dy;
+	int action;
+} RecordedFrame;
+
+/* runs are kept in fixed size chunks, so a recording never moves once written and can be read by any number of clones */
+struct Recording {
+	CloneRun **chunks;
+	int numChunks;
+	int numRuns;
+	int *blocks;
+	int numBlocks;
+	int blockCapacity;
+	int users;
+	Recording *next;
 };
 
 typedef struct {
 	int action;
 	int equipment;
-	int advanceData;
-	CloneData *dataHead, *pData;
-	CloneData data;
+	int playing;
+	Recording *recording;
 } Walter;
 
+typedef struct {
+	int type;
+	int id;
+	int channel;
+	int x, y;
+	int destX, destY;
+	int active;
+	int target;
+	int facing;
+	float px, py;
+	Entity *entity;
+	void (*particles)(int x, int y);
+} Command;
+
+typedef struct {
+	Command *commands;
+	int numCommands;
+	int capacity;
+} CommandBuffer;
+
+typedef struct {
+	AtlasImage *atlasImage;
+	float speed;
+	int background;
+	int targets;
+	struct {
+		int r;
+		int g;
+		int b;
+		int a;
+	} light;
+} ProjectileDef;
+
+typedef struct {
+	int projectile;
+	Entity *target;
+} ProjectileHit;
+
+/* the live projectiles are always the first count, in the order they were fired */
+typedef struct {
+	int count;
+	float x[MAX_PROJECTILES];
+	float y[MAX_PROJECTILES];
+	float dx[MAX_PROJECTILES];
+	float dy[MAX_PROJECTILES];
+	float gravity[MAX_PROJECTILES];
+	int type[MAX_PROJECTILES];
+	int facing[MAX_PROJECTILES];
+	int timer[MAX_PROJECTILES];
+	int alive[MAX_PROJECTILES];
+} Projectiles;
+
+typedef struct {
+	AtlasImage *atlasImage;
+	int x;
+	int y;
+	int flip;
+} TileSprite;
+
+/* sprites sorted by the tile their top left corner is in: tile i holds sprites[cells[i]] up to sprites[cells[i + 1] - 1] */
+typedef struct {
+	int numSprites;
+	int capacity;
+	TileSprite *sprites;
+	int cells[MAP_WIDTH * MAP_HEIGHT + 1];
+	int maxW;
+	int maxH;
+} TileLayer;
+
 struct Particle {
 	float x;
 	float y;
@@ -197,19 +480,27 @@ typedef struct {
 	int map[MAP_WIDTH][MAP_HEIGHT];
 	AtlasImage *tiles[MAX_TILES];
 	Entity entityHead, *entityTail;
-	Entity *player;
+	EntityHandle player;
+	EntityHandle partner;
+	Entity *typeHead[ET_MAX];
+	Entity *typeTail[ET_MAX];
 	Particle particleHead, *particleTail;
+	Projectiles projectiles;
 	unsigned int clones, cloneLimit;
 	unsigned int time, timeLimit;
 	int keys, totalKeys;
 	int coins, totalCoins;
 	int items, totalItems;
+	unsigned int seed;
 	int frame;
 	int reset;
+	int partnerControls;
+	int skipEffects;
+	int predicting;
 	int status;
 	int nextStageTimer;
 	char tips[MAX_TIPS][MAX_DESCRIPTION_LENGTH];
-	CloneData cloneDataHead, *cloneDataTail;
+	Recording *recording;
 	Quadtree quadtree;
 	struct {
 		int x;
@@ -219,6 +510,43 @@ typedef struct {
 	} camera;
 } Stage;
 
+/* sent by each co-op peer every frame: its inputs from the first one the other hasn't acknowledged */
+typedef struct {
+	char magic[4];
+	int stageNum;
+	int attempt;
+	int ack;
+	int first;
+	int count;
+	Uint16 inputs[NETPLAY_MAX_INPUTS];
+} NetplayPacket;
+
+/* a compiled stage's entities are a CompiledEntitiesHeader, little endian, followed by numEnts records */
+typedef struct {
+	char magic[4];
+	int version;
+	unsigned int schema;
+	unsigned int source;
+	int numEnts;
+} CompiledEntitiesHeader;
+
+/* a replay file is a ReplayHeader followed by numRuns ReplayRuns */
+typedef struct {
+	char magic[4];
+	int version;
+	unsigned int buildHash;
+	int stageNum;
+	unsigned int seed;
+	int numFrames;
+	int numRuns;
+} ReplayHeader;
+
+/* the CONTROL_ bits held for length consecutive frames */
+typedef struct {
+	Uint16 controls;
+	Uint16 length;
+} ReplayRun;
+
 struct StageMeta {
 	int stageNum;
 	int coins, coinsFound;
@@ -313,11 +641,41 @@ typedef struct {
 		int type;
 		int value;
 	} wipe;
+	/* set by the tools that run stages without anyone playing them, so that nothing is saved */
+	int headless;
 	struct {
 		int debug;
 		int fps;
 		int ents;
 		int collisions;
 		int drawing;
+		int drawCalls;
+		int pooledEnts;
+		int peakEnts;
+		int pooledData;
+		int peakData;
+		int phased;
+		int spawnOrder;
+		int rewindFrames;
+		int rewindBytes;
+		int rewindCost;
+		int predictionFrames;
+		int predictionCost;
+		int rollbackFrames;
+		int rollbackCost;
+		int netplayAhead;
+		int netplayStalls;
 	} dev;
+	struct {
+		int record;
+		int playing;
+		int controls;
+	} replay;
+	struct {
+		int active;
+		int host;
+		int ticking;
+		int controls;
+		int waiting;
+	} netplay;
 } App;
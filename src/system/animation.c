@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+#include "../common.h"
+#include "animation.h"
+
+extern Stage stage;
+
+void addAnimFrame(AnimClip *clip, AtlasImage *image, int duration)
+{
+	if (clip->numFrames == MAX_ANIM_FRAMES)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Too many frames in clip starting '%s'", clip->frames[0]->filename);
+		exit(1);
+	}
+
+	clip->frames[clip->numFrames] = image;
+	clip->durations[clip->numFrames] = duration;
+	clip->numFrames++;
+
+	clip->length += duration;
+}
+
+void playAnimClip(Entity *e, AnimClip *clip)
+{
+	e->anim = clip;
+	e->animStart = stage.frame;
+}
+
+/* starts a bobbing pickup anywhere in its bob, picked by position rather than rand() so that a reset can skip this */
+void initBobPhase(Entity *e)
+{
+	e->animStart = ((int)e->x + (int)e->y) % 64;
+}
+
+/* stage.frame goes back to 0 when the clones restart, so this can briefly be negative */
+int getAnimTime(Entity *e)
+{
+	return stage.frame - e->animStart;
+}
+
+/* only called when the entity is drawn, so nothing is spent animating what can't be seen */
+AtlasImage *getAnimFrame(Entity *e)
+{
+	AnimClip *clip;
+	int i, t;
+
+	clip = e->anim;
+
+	if (clip->numFrames == 0)
+	{
+		return e->atlasImage;
+	}
+
+	t = getAnimTime(e);
+
+	if (clip->loop)
+	{
+		t %= clip->length;
+
+		if (t < 0)
+		{
+			t += clip->length;
+		}
+	}
+
+	/* a clip that doesn't loop holds its last frame */
+	for (i = 0 ; i < clip->numFrames - 1 ; i++)
+	{
+		t -= clip->durations[i];
+
+		if (t < 0)
+		{
+			break;
+		}
+	}
+
+	return clip->frames[i];
+}
+
+float getAnimBob(Entity *e)
+{
+	if (e->anim->bob == 0)
+	{
+		return 0;
+	}
+
+	return sin(getAnimTime(e) * 0.1) * e->anim->bob;
+}
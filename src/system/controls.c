@@ -27,6 +27,18 @@ int isControl(int type)
 {
 	int key, btn;
 
+	/* during a co-op frame, the player's controls are whichever peer's input drives them */
+	if (app.netplay.ticking && type != CONTROL_PAUSE)
+	{
+		return (app.netplay.controls >> type) & 1;
+	}
+
+	/* whoever is watching a replay can still speed it up */
+	if (app.replay.playing && type != CONTROL_FAST_FORWARD)
+	{
+		return (app.replay.controls >> type) & 1;
+	}
+
 	key = app.config.keyControls[type];
 	btn = app.config.joypadControls[type];
 
@@ -63,9 +75,19 @@ void clearControl(int type)
 	int key;
 	int btn;
 
+	/* a co-op frame may be a rerun, long after the device's own press was taken */
+	if (app.netplay.ticking && type != CONTROL_PAUSE)
+	{
+		app.netplay.controls &= ~(1 << type);
+
+		return;
+	}
+
 	key = app.config.keyControls[type];
 	btn = app.config.joypadControls[type];
 
+	app.replay.controls &= ~(1 << type);
+
 	if (key != 0)
 	{
 		app.keyboard[key] = 0;
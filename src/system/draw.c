@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "draw.h"
+#include "../system/spriteBatch.h"
 #include "../system/text.h"
 
 extern App app;
@@ -41,6 +42,8 @@ void initGraphics(void)
 	initColor(&app.colors.darkGrey, 128, 128, 128);
 
 	app.backBuffer = SDL_CreateTexture(app.renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+	initSpriteBatch();
 }
 
 void prepareScene(void)
@@ -48,15 +51,30 @@ void prepareScene(void)
 	SDL_SetRenderTarget(app.renderer, app.backBuffer);
 	SDL_SetRenderDrawColor(app.renderer, 0, 0, 0, 255);
 	SDL_RenderClear(app.renderer);
+
+	app.dev.drawCalls = 0;
 }
 
 void presentScene(void)
 {
 	if (app.dev.debug)
 	{
-		drawText(SCREEN_WIDTH - 5, SCREEN_HEIGHT - 30, 32, TEXT_RIGHT, app.colors.white, "%dfps | Ents: %d | Cols: %d | Draw: %d", app.dev.fps, app.dev.ents, app.dev.collisions, app.dev.drawing);
+		drawText(SCREEN_WIDTH - 5, SCREEN_HEIGHT - 30, 32, TEXT_RIGHT, app.colors.white, "%dfps | Ents: %d | Cols: %d | Draw: %d (%d calls)", app.dev.fps, app.dev.ents, app.dev.collisions, app.dev.drawing, app.dev.drawCalls);
+
+		drawText(SCREEN_WIDTH - 5, SCREEN_HEIGHT - 60, 32, TEXT_RIGHT, app.colors.white, "Pooled ents: %d (peak %d) | Pooled data: %d (peak %d)", app.dev.pooledEnts, app.dev.peakEnts, app.dev.pooledData, app.dev.peakData);
+
+		drawText(SCREEN_WIDTH - 5, SCREEN_HEIGHT - 90, 32, TEXT_RIGHT, app.colors.white, "Rewind: %.1fs | %dKB of %dKB | %dus", app.dev.rewindFrames / (float)FPS, app.dev.rewindBytes / 1024, REWIND_BUFFER_SIZE / 1024, app.dev.rewindCost);
+
+		drawText(SCREEN_WIDTH - 5, SCREEN_HEIGHT - 120, 32, TEXT_RIGHT, app.colors.white, "Prediction: %d of %d frames | %dus", app.dev.predictionFrames, PREDICTION_FRAMES, app.dev.predictionCost);
+
+		if (app.netplay.active)
+		{
+			drawText(SCREEN_WIDTH - 5, SCREEN_HEIGHT - 150, 32, TEXT_RIGHT, app.colors.white, "Rollback: %d frames | %dus | %d ahead | %d stalls", app.dev.rollbackFrames, app.dev.rollbackCost, app.dev.netplayAhead, app.dev.netplayStalls);
+		}
 	}
 
+	flushSprites();
+
 	SDL_SetRenderTarget(app.renderer, NULL);
 	SDL_RenderCopy(app.renderer, app.backBuffer, NULL, NULL);
 	SDL_RenderPresent(app.renderer);
@@ -76,10 +94,16 @@ void blit(SDL_Texture *texture, int x, int y, int center, SDL_RendererFlip flip)
 		dest.y -= dest.h / 2;
 	}
 
-	SDL_RenderCopyEx(app.renderer, texture, NULL, &dest, 0, NULL, flip);
+	drawSprite(texture, NULL, &dest, flip, app.colors.white);
 }
 
 void blitAtlasImage(AtlasImage *atlasImage, int x, int y, int center, SDL_RendererFlip flip)
+{
+	blitTintedAtlasImage(atlasImage, x, y, center, flip, app.colors.white);
+}
+
+/* the colour takes the place of the texture's colour and alpha mods */
+void blitTintedAtlasImage(AtlasImage *atlasImage, int x, int y, int center, SDL_RendererFlip flip, SDL_Color color)
 {
 	SDL_Rect dest;
 
@@ -94,7 +118,7 @@ void blitAtlasImage(AtlasImage *atlasImage, int x, int y, int center, SDL_Render
 		dest.y -= (dest.h / 2);
 	}
 
-	SDL_RenderCopyEx(app.renderer, atlasImage->texture, &atlasImage->rect, &dest, 0, NULL, flip);
+	drawSprite(atlasImage->texture, &atlasImage->rect, &dest, flip, color);
 }
 
 void drawRect(int x, int y, int w, int h, int r, int g, int b, int a)
@@ -105,6 +129,10 @@ void drawRect(int x, int y, int w, int h, int r, int g, int b, int a)
 	rect.w = w;
 	rect.h = h;
 
+	flushSprites();
+
+	app.dev.drawCalls++;
+
 	SDL_SetRenderDrawBlendMode(app.renderer, a < 255 ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
 	SDL_SetRenderDrawColor(app.renderer, r, g, b, a);
 	SDL_RenderFillRect(app.renderer, &rect);
@@ -118,6 +146,10 @@ void drawOutlineRect(int x, int y, int w, int h, int r, int g, int b, int a)
 	rect.w = w;
 	rect.h = h;
 
+	flushSprites();
+
+	app.dev.drawCalls++;
+
 	SDL_SetRenderDrawBlendMode(app.renderer, a < 255 ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
 	SDL_SetRenderDrawColor(app.renderer, r, g, b, a);
 	SDL_RenderDrawRect(app.renderer, &rect);
@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 void drawOutlineRect(int x, int y, int w, int h, int r, int g, int b, int a);
 void drawRect(int x, int y, int w, int h, int r, int g, int b, int a);
+void blitTintedAtlasImage(AtlasImage *atlasImage, int x, int y, int center, SDL_RendererFlip flip, SDL_Color color);
 void blitAtlasImage(AtlasImage *atlasImage, int x, int y, int center, SDL_RendererFlip flip);
 void blit(SDL_Texture *texture, int x, int y, int center, SDL_RendererFlip flip);
 void presentScene(void);
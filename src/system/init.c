@@ -36,6 +36,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../system/atlas.h"
 #include "../plat/win32/win32Init.h"
 #include "../world/entityFactory.h"
+#include "../system/jobs.h"
+#include "../world/commandBuffer.h"
+#include "../world/entityPool.h"
+#include "../world/targets.h"
+#include "../world/projectiles.h"
+#include "../world/rewind.h"
+#include "../world/prediction.h"
+#include "../game/netplay.h"
+#include "../world/tileLayers.h"
+#include "../world/map.h"
 
 extern App app;
 
@@ -121,9 +131,14 @@ void initGame(void)
 		initFonts,
 		initSounds,
 		initJoypad,
+		initJobs,
+		initEntityPools,
 		initWidgets,
 		initEntityFactory,
 		initParticles,
+		initProjectiles,
+		initRewind,
+		initPrediction,
 		initStageMetaData
 	};
 
@@ -171,6 +186,26 @@ void cleanup(void)
 		SDL_JoystickClose(app.joypad);
 	}
 
+	destroyJobs();
+
+	destroyEntityPools();
+
+	destroyTargets();
+
+	destroyProjectiles();
+
+	destroyRewind();
+
+	destroyPrediction();
+
+	destroyNetplay();
+
+	destroyTileLayers();
+
+	destroyMap();
+
+	destroyCommandBuffers();
+
 	destroyTextures();
 
 	destroySounds();
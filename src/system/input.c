@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "input.h"
+#include "../world/map.h"
 
 extern App app;
 
@@ -139,6 +140,12 @@ void doInput(void)
 				doJoyAxis(&event.jaxis);
 				break;
 
+			/* render targets can lose what was drawn to them (on Direct3D, for one) */
+			case SDL_RENDER_TARGETS_RESET:
+			case SDL_RENDER_DEVICE_RESET:
+				invalidateChunks();
+				break;
+
 			case SDL_QUIT:
 				exit(0);
 				break;
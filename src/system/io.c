@@ -33,7 +33,8 @@ int fileExists(const char *filename)
 	return (stat(filename, &buffer) == 0);
 }
 
-const char *getFileLocation(const char *filename)
+/* NULL if it's neither here nor in the data dir */
+const char *findFileLocation(const char *filename)
 {
 	static char path[MAX_FILENAME_LENGTH];
 
@@ -46,9 +47,18 @@ const char *getFileLocation(const char *filename)
 
 	sprintf(path, DATA_DIR"/%s", filename);
 
-	if (!fileExists(path))
+	return fileExists(path) ? path : NULL;
+}
+
+const char *getFileLocation(const char *filename)
+{
+	const char *path;
+
+	path = findFileLocation(filename);
+
+	if (path == NULL)
 	{
-		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "No such file '%s'", path);
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "No such file '"DATA_DIR"/%s'", filename);
 		exit(1);
 	}
 
@@ -95,6 +105,54 @@ int writeFile(const char *filename, const char *data)
 	return 0;
 }
 
+int writeBinaryFile(const char *filename, const void *data, int length)
+{
+	FILE *file;
+	int written;
+
+	file = fopen(filename, "wb");
+
+	if (file)
+	{
+		written = fwrite(data, 1, length, file);
+		fclose(file);
+		return written == length;
+	}
+
+	return 0;
+}
+
+/* NULL if it can't be read, otherwise its length is put in length */
+char *readBinaryFile(const char *filename, int *length)
+{
+	char *buffer;
+	FILE *file;
+
+	buffer = NULL;
+
+	file = fopen(filename, "rb");
+
+	if (file)
+	{
+		fseek(file, 0, SEEK_END);
+		*length = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		buffer = malloc(MAX(*length, 1));
+
+		if (fread(buffer, 1, *length, file) != *length)
+		{
+			free(buffer);
+
+			buffer = NULL;
+		}
+
+		fclose(file);
+	}
+
+	return buffer;
+}
+
 char **getFileList(const char *dir, int *count)
 {
 	DIR *d;
@@ -19,7 +19,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 char **getFileList(const char *dir, int *count);
+char *readBinaryFile(const char *filename, int *length);
+int writeBinaryFile(const char *filename, const void *data, int length);
 int writeFile(const char *filename, const char *data);
 char *readFile(const char *filename);
 const char *getFileLocation(const char *filename);
+const char *findFileLocation(const char *filename);
 int fileExists(const char *filename);
@@ -0,0 +1,127 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "jobs.h"
+
+static int doWorker(void *data);
+
+static SDL_Thread *threads[MAX_JOB_THREADS];
+static SDL_sem *startSems[MAX_JOB_THREADS];
+static SDL_sem *doneSem;
+static int sliceIds[MAX_JOB_THREADS];
+static void (*jobFunc)(int slice, int numSlices);
+static int numSlices;
+static int running;
+
+void initJobs(void)
+{
+	int i;
+
+	numSlices = MIN(MAX(SDL_GetCPUCount(), 1), MAX_JOB_THREADS);
+
+	running = 1;
+
+	doneSem = SDL_CreateSemaphore(0);
+
+	/* slice 0 is always run by the calling thread */
+	for (i = 1 ; i < numSlices ; i++)
+	{
+		sliceIds[i] = i;
+
+		startSems[i] = SDL_CreateSemaphore(0);
+
+		threads[i] = SDL_CreateThread(doWorker, "jobWorker", &sliceIds[i]);
+	}
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Job slices: %d", numSlices);
+}
+
+int getNumJobSlices(void)
+{
+	return numSlices;
+}
+
+/* runs func once per slice, across all workers, and returns when every slice has finished */
+void runJobs(void (*func)(int slice, int numSlices))
+{
+	int i;
+
+	jobFunc = func;
+
+	for (i = 1 ; i < numSlices ; i++)
+	{
+		SDL_SemPost(startSems[i]);
+	}
+
+	func(0, numSlices);
+
+	for (i = 1 ; i < numSlices ; i++)
+	{
+		SDL_SemWait(doneSem);
+	}
+}
+
+static int doWorker(void *data)
+{
+	int slice;
+
+	slice = *((int*)data);
+
+	while (1)
+	{
+		SDL_SemWait(startSems[slice]);
+
+		if (!running)
+		{
+			break;
+		}
+
+		jobFunc(slice, numSlices);
+
+		SDL_SemPost(doneSem);
+	}
+
+	return 0;
+}
+
+void destroyJobs(void)
+{
+	int i;
+
+	running = 0;
+
+	for (i = 1 ; i < numSlices ; i++)
+	{
+		SDL_SemPost(startSems[i]);
+
+		SDL_WaitThread(threads[i], NULL);
+
+		SDL_DestroySemaphore(startSems[i]);
+	}
+
+	if (doneSem != NULL)
+	{
+		SDL_DestroySemaphore(doneSem);
+	}
+
+	numSlices = 0;
+}
+
@@ -60,6 +60,8 @@ void initLookups(void)
 	addLookup("use", CONTROL_USE);
 	addLookup("clone", CONTROL_CLONE);
 	addLookup("restart", CONTROL_RESTART);
+	addLookup("rewind", CONTROL_REWIND);
+	addLookup("fastForward", CONTROL_FAST_FORWARD);
 	addLookup("pause", CONTROL_PAUSE);
 }
 
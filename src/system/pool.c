@@ -0,0 +1,193 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "pool.h"
+#include "../system/util.h"
+
+static void addSlab(Pool *pool);
+static PoolBlock *getBlock(Pool *pool, int index);
+
+void initPool(Pool *pool, const char *name, int itemSize, int perSlab)
+{
+	memset(pool, 0, sizeof(Pool));
+
+	STRNCPY(pool->name, name, MAX_NAME_LENGTH);
+
+	/* rounded up to a whole number of headers, so every item stays pointer aligned */
+	pool->itemSize = itemSize;
+	pool->blockSize = sizeof(PoolBlock) * (1 + (itemSize + sizeof(PoolBlock) - 1) / sizeof(PoolBlock));
+	pool->perSlab = perSlab;
+}
+
+/* items come back zeroed, as they would from malloc and memset */
+void *allocPoolItem(Pool *pool)
+{
+	PoolBlock *block;
+
+	SDL_AtomicLock(&pool->lock);
+
+	if (pool->freeList == NULL)
+	{
+		addSlab(pool);
+	}
+
+	block = pool->freeList;
+	pool->freeList = block->next;
+
+	pool->live++;
+	pool->peak = MAX(pool->peak, pool->live);
+
+	SDL_AtomicUnlock(&pool->lock);
+
+	block->next = NULL;
+
+	memset(block + 1, 0, pool->itemSize);
+
+	return block + 1;
+}
+
+void freePoolItem(void *item)
+{
+	PoolBlock *block;
+	Pool *pool;
+
+	if (item == NULL)
+	{
+		return;
+	}
+
+	block = ((PoolBlock*)item) - 1;
+	pool = block->pool;
+
+	SDL_AtomicLock(&pool->lock);
+
+	/* anything still holding the old generation will now fail to find the item */
+	if (++block->generation == 0)
+	{
+		block->generation = 1;
+	}
+
+	block->next = pool->freeList;
+	pool->freeList = block;
+
+	pool->live--;
+
+	SDL_AtomicUnlock(&pool->lock);
+}
+
+int getPoolItemIndex(void *item)
+{
+	return (((PoolBlock*)item) - 1)->index;
+}
+
+unsigned int getPoolItemGeneration(void *item)
+{
+	return (((PoolBlock*)item) - 1)->generation;
+}
+
+Pool *getPoolItemPool(void *item)
+{
+	return (((PoolBlock*)item) - 1)->pool;
+}
+
+/* NULL if the item at index has been freed (and perhaps reused) since the generation was taken */
+void *getPoolItem(Pool *pool, int index, unsigned int generation)
+{
+	PoolBlock *block;
+
+	if (generation == 0 || index < 0 || index >= pool->capacity)
+	{
+		return NULL;
+	}
+
+	block = getBlock(pool, index);
+
+	return block->generation == generation ? block + 1 : NULL;
+}
+
+/* hands every block back at once, keeping the slabs for the next user */
+void resetPool(Pool *pool)
+{
+	PoolBlock *block;
+	int i;
+
+	pool->freeList = NULL;
+
+	for (i = pool->capacity - 1 ; i >= 0 ; i--)
+	{
+		block = getBlock(pool, i);
+
+		if (++block->generation == 0)
+		{
+			block->generation = 1;
+		}
+
+		block->next = pool->freeList;
+		pool->freeList = block;
+	}
+
+	pool->live = 0;
+}
+
+static PoolBlock *getBlock(Pool *pool, int index)
+{
+	return (PoolBlock*)(pool->slabs[index / pool->perSlab] + ((index % pool->perSlab) * pool->blockSize));
+}
+
+static void addSlab(Pool *pool)
+{
+	PoolBlock *block;
+	int i;
+
+	pool->slabs = resize(pool->slabs, sizeof(char*) * pool->numSlabs, sizeof(char*) * (pool->numSlabs + 1));
+
+	pool->slabs[pool->numSlabs++] = malloc(pool->blockSize * pool->perSlab);
+
+	pool->capacity += pool->perSlab;
+
+	/* pushed in reverse, so the slab is handed out front to back */
+	for (i = pool->capacity - 1 ; i >= pool->capacity - pool->perSlab ; i--)
+	{
+		block = getBlock(pool, i);
+		block->pool = pool;
+		block->index = i;
+		block->generation = 1;
+		block->next = pool->freeList;
+		pool->freeList = block;
+	}
+}
+
+void destroyPool(Pool *pool)
+{
+	int i;
+
+	for (i = 0 ; i < pool->numSlabs ; i++)
+	{
+		free(pool->slabs[i]);
+	}
+
+	free(pool->slabs);
+
+	pool->slabs = NULL;
+	pool->freeList = NULL;
+	pool->numSlabs = pool->capacity = pool->live = 0;
+}
+
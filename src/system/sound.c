@@ -23,6 +23,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <SDL2/SDL_mixer.h>
 #include "../system/util.h"
 #include "../system/io.h"
+#include "../world/commandBuffer.h"
+
+extern Stage stage;
 
 static void loadSounds(void);
 static void channelDone(int c);
@@ -74,6 +77,17 @@ void playMusic(int loop)
 
 void playSound(int id, int channel)
 {
+	if (stage.predicting)
+	{
+		return;
+	}
+
+	if (isDeferring())
+	{
+		deferSound(id, channel);
+		return;
+	}
+
 	Mix_PlayChannel(channel, sounds[id], 0);
 }
 
@@ -81,6 +95,18 @@ void playPositionalSound(int id, int channel, int srcX, int srcY, int destX, int
 {
 	float distance, bearing, vol;
 
+	/* a tick fast-forward runs between frames */
+	if (stage.skipEffects)
+	{
+		return;
+	}
+
+	if (isDeferring())
+	{
+		deferPositionalSound(id, channel, srcX, srcY, destX, destY);
+		return;
+	}
+
 	distance = getDistance(destX, destY, srcX, srcY);
 
 	if (distance <= SCREEN_WIDTH)
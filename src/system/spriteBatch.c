@@ -0,0 +1,136 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "spriteBatch.h"
+
+extern App app;
+
+static SDL_Vertex vertices[SPRITE_BATCH_SIZE * 4];
+static int indices[SPRITE_BATCH_SIZE * 6];
+static SDL_Texture *batchTexture;
+static int textureWidth;
+static int textureHeight;
+static int numSprites;
+
+/*
+ * Nearly everything is drawn from the atlas, so rather than a copy per sprite, each one is
+ * added as a quad to a shared vertex buffer, and the lot are drawn with a single call to
+ * SDL_RenderGeometry when the texture (and with it the blend mode) changes, the buffer fills,
+ * or something that isn't a sprite needs drawing. Colour is carried by the vertices, so
+ * textures are never tinted.
+ */
+void initSpriteBatch(void)
+{
+	int i;
+
+	for (i = 0 ; i < SPRITE_BATCH_SIZE ; i++)
+	{
+		indices[(i * 6) + 0] = (i * 4) + 0;
+		indices[(i * 6) + 1] = (i * 4) + 1;
+		indices[(i * 6) + 2] = (i * 4) + 2;
+		indices[(i * 6) + 3] = (i * 4) + 2;
+		indices[(i * 6) + 4] = (i * 4) + 3;
+		indices[(i * 6) + 5] = (i * 4) + 0;
+	}
+
+	numSprites = 0;
+}
+
+void flushSprites(void)
+{
+	if (numSprites > 0)
+	{
+		SDL_RenderGeometry(app.renderer, batchTexture, vertices, numSprites * 4, indices, numSprites * 6);
+
+		app.dev.drawCalls++;
+
+		numSprites = 0;
+	}
+
+	/* the texture could be gone by the next sprite, and another made in its place */
+	batchTexture = NULL;
+}
+
+/* src can be NULL for the whole texture */
+void drawSprite(SDL_Texture *texture, SDL_Rect *src, SDL_Rect *dest, SDL_RendererFlip flip, SDL_Color color)
+{
+	SDL_Vertex *v;
+	float u1, v1, u2, v2, t;
+	int i;
+
+	if (texture != batchTexture || numSprites == SPRITE_BATCH_SIZE)
+	{
+		flushSprites();
+	}
+
+	if (texture != batchTexture)
+	{
+		batchTexture = texture;
+
+		SDL_QueryTexture(texture, NULL, NULL, &textureWidth, &textureHeight);
+	}
+
+	if (src != NULL)
+	{
+		u1 = src->x / (float)textureWidth;
+		v1 = src->y / (float)textureHeight;
+		u2 = (src->x + src->w) / (float)textureWidth;
+		v2 = (src->y + src->h) / (float)textureHeight;
+	}
+	else
+	{
+		u1 = v1 = 0;
+		u2 = v2 = 1;
+	}
+
+	if (flip & SDL_FLIP_HORIZONTAL)
+	{
+		t = u1;
+		u1 = u2;
+		u2 = t;
+	}
+
+	if (flip & SDL_FLIP_VERTICAL)
+	{
+		t = v1;
+		v1 = v2;
+		v2 = t;
+	}
+
+	v = &vertices[numSprites * 4];
+
+	v[0].position.x = v[3].position.x = dest->x;
+	v[1].position.x = v[2].position.x = dest->x + dest->w;
+	v[0].position.y = v[1].position.y = dest->y;
+	v[2].position.y = v[3].position.y = dest->y + dest->h;
+
+	v[0].tex_coord.x = v[3].tex_coord.x = u1;
+	v[1].tex_coord.x = v[2].tex_coord.x = u2;
+	v[0].tex_coord.y = v[1].tex_coord.y = v1;
+	v[2].tex_coord.y = v[3].tex_coord.y = v2;
+
+	for (i = 0 ; i < 4 ; i++)
+	{
+		v[i].color = color;
+	}
+
+	numSprites++;
+}
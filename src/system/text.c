@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <SDL2/SDL_ttf.h>
 #include "../system/textures.h"
 #include "../system/io.h"
+#include "../system/spriteBatch.h"
 
 #define FONT_SIZE            32
 #define FONT_TEXTURE_SIZE    512
@@ -39,6 +40,7 @@ static int toHex(char c);
 static char drawTextBuffer[MAX_LINE_LENGTH];
 static float scale;
 static int ignoreColors;
+static SDL_Color textColor;
 static SDL_Color prevColor;
 static SDL_Rect glyphs[128];
 static SDL_Texture *fontTexture;
@@ -124,14 +126,12 @@ void drawText(int x, int y, int size, int align, SDL_Color color, const char *fo
 	{
 		ignoreColors = 1;
 
-		SDL_SetTextureColorMod(fontTexture, 0, 0, 0);
-		SDL_SetTextureAlphaMod(fontTexture, 255);
+		textColor = app.colors.black;
 
 		drawTextLine(x + 2, y + 2, size, align, drawTextBuffer);
 		drawTextLine(x + 1, y + 1, size, align, drawTextBuffer);
 
-		SDL_SetTextureColorMod(fontTexture, color.r, color.g, color.b);
-		SDL_SetTextureAlphaMod(fontTexture, color.a);
+		textColor = color;
 
 		ignoreColors = 0;
 
@@ -141,14 +141,12 @@ void drawText(int x, int y, int size, int align, SDL_Color color, const char *fo
 	{
 		ignoreColors = 1;
 
-		SDL_SetTextureColorMod(fontTexture, 0, 0, 0);
-		SDL_SetTextureAlphaMod(fontTexture, 255);
+		textColor = app.colors.black;
 
 		drawTextLines(x + 2, y + 2, size, align);
 		drawTextLines(x + 1, y + 1, size, align);
 
-		SDL_SetTextureColorMod(fontTexture, color.r, color.g, color.b);
-		SDL_SetTextureAlphaMod(fontTexture, color.a);
+		textColor = color;
 
 		ignoreColors = 0;
 
@@ -246,7 +244,6 @@ static void drawWord(char *word, int *x, int *y, int startX)
 	int i;
 	int character;
 	SDL_Rect dest, *g;
-	SDL_Color c;
 
 	i = 0;
 
@@ -256,18 +253,16 @@ static void drawWord(char *word, int *x, int *y, int startX)
 		{
 			if (word[1] == '!')
 			{
-				SDL_SetTextureColorMod(fontTexture, prevColor.r, prevColor.g, prevColor.b);
+				textColor = prevColor;
 
 				return;
 			}
 
-			c.r = toHex(word[1]);
-			c.g = toHex(word[2]);
-			c.b = toHex(word[3]);
+			prevColor = textColor;
 
-			SDL_GetTextureColorMod(fontTexture, &prevColor.r, &prevColor.g, &prevColor.b);
-
-			SDL_SetTextureColorMod(fontTexture, c.r, c.g, c.b);
+			textColor.r = toHex(word[1]);
+			textColor.g = toHex(word[2]);
+			textColor.b = toHex(word[3]);
 		}
 
 		return;
@@ -284,7 +279,7 @@ static void drawWord(char *word, int *x, int *y, int startX)
 		dest.w = g->w * scale;
 		dest.h = g->h * scale;
 
-		SDL_RenderCopy(app.renderer, fontTexture, g, &dest);
+		drawSprite(fontTexture, g, &dest, SDL_FLIP_NONE, textColor);
 
 		*x += g->w * scale;
 
@@ -0,0 +1,138 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "transport.h"
+#include "../plat/win32/win32Net.h"
+
+typedef struct {
+	char data[sizeof(NetplayPacket)];
+	int length;
+} LoopbackPacket;
+
+static int sendLoopback(void *data, int length);
+static int receiveLoopback(void *data, int length);
+static void closeLoopback(void);
+
+static int (*sendFunc)(void *data, int length);
+static int (*receiveFunc)(void *data, int length);
+static void (*closeFunc)(void);
+static LoopbackPacket *loopback;
+static int loopbackDelay;
+static int numSent;
+static int numReceived;
+
+/* with no host, waits on port for the other player to get in touch */
+void initUDPTransport(const char *host, int port)
+{
+	if (!openSocket(host, port))
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Couldn't open UDP socket for %s:%d", host != NULL ? host : "*", port);
+		exit(1);
+	}
+
+	sendFunc = sendSocket;
+	receiveFunc = receiveSocket;
+	closeFunc = closeSocket;
+}
+
+/*
+ * A stand-in for the network, for testing: whatever is sent comes back as though the other
+ * player had sent it, once delay more packets have gone out. As a packet goes every frame,
+ * the partner copies the player delay frames late, which is enough to keep rollback busy.
+ */
+void initLoopbackTransport(int delay)
+{
+	loopback = malloc(sizeof(LoopbackPacket) * LOOPBACK_PACKETS);
+
+	loopbackDelay = MIN(MAX(delay, 0), LOOPBACK_PACKETS - 1);
+
+	numSent = numReceived = 0;
+
+	sendFunc = sendLoopback;
+	receiveFunc = receiveLoopback;
+	closeFunc = closeLoopback;
+}
+
+static int sendLoopback(void *data, int length)
+{
+	LoopbackPacket *p;
+
+	/* the oldest is dropped, as it would be by a full socket buffer */
+	if (numSent - numReceived == LOOPBACK_PACKETS)
+	{
+		numReceived++;
+	}
+
+	p = &loopback[numSent % LOOPBACK_PACKETS];
+	memcpy(p->data, data, length);
+	p->length = length;
+
+	numSent++;
+
+	return 1;
+}
+
+static int receiveLoopback(void *data, int length)
+{
+	LoopbackPacket *p;
+
+	if (numSent - numReceived <= loopbackDelay)
+	{
+		return 0;
+	}
+
+	p = &loopback[numReceived % LOOPBACK_PACKETS];
+	memcpy(data, p->data, MIN(length, p->length));
+
+	numReceived++;
+
+	return MIN(length, p->length);
+}
+
+static void closeLoopback(void)
+{
+	free(loopback);
+
+	loopback = NULL;
+}
+
+int sendPacket(void *data, int length)
+{
+	return sendFunc != NULL && sendFunc(data, length);
+}
+
+/* the length of the next packet waiting, or 0 if there isn't one */
+int receivePacket(void *data, int length)
+{
+	return receiveFunc != NULL ? receiveFunc(data, length) : 0;
+}
+
+void closeTransport(void)
+{
+	if (closeFunc != NULL)
+	{
+		closeFunc();
+	}
+
+	sendFunc = NULL;
+	receiveFunc = NULL;
+	closeFunc = NULL;
+}
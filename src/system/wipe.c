@@ -68,6 +68,24 @@ int doWipe(void)
 	return 1;
 }
 
+int isWiping(void)
+{
+	switch (app.wipe.type)
+	{
+		case WIPE_FADE:
+			return app.wipe.value > 0;
+
+		case WIPE_IN:
+		case WIPE_OUT:
+			return app.wipe.value < SCREEN_WIDTH;
+
+		default:
+			break;
+	}
+
+	return 0;
+}
+
 static int doFadeIn(void)
 {
 	app.wipe.value -= 255 / 20;
@@ -19,5 +19,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 void drawWipe(void);
+int isWiping(void);
 int doWipe(void);
 void initWipe(int type);
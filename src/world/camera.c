@@ -20,13 +20,25 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../common.h"
 #include "camera.h"
+#include "../world/entityPool.h"
 
+extern App app;
 extern Stage stage;
 
 void doCamera(void)
 {
-	stage.camera.x = (int) stage.player->x + (stage.player->w / 2);
-	stage.camera.y = (int) stage.player->y + (stage.player->h / 2);
+	Entity *player;
+
+	player = getPlayer();
+
+	/* in co-op, each player follows their own Walter, for as long as there's one to follow */
+	if (app.netplay.active && !app.netplay.host && getPartner() != NULL)
+	{
+		player = getPartner();
+	}
+
+	stage.camera.x = (int) player->x + (player->w / 2);
+	stage.camera.y = (int) player->y + (player->h / 2);
 
 	stage.camera.x -= (SCREEN_WIDTH / 2);
 	stage.camera.y -= (SCREEN_HEIGHT / 2);
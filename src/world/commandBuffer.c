@@ -0,0 +1,206 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "commandBuffer.h"
+#include "../system/util.h"
+#include "../system/sound.h"
+#include "../world/entities.h"
+#include "../world/entityFactory.h"
+#include "../world/projectiles.h"
+
+#define INITIAL_COMMAND_CAPACITY    32
+
+enum
+{
+	CMD_SOUND,
+	CMD_POSITIONAL_SOUND,
+	CMD_PARTICLES,
+	CMD_ACTIVATE,
+	CMD_SPAWN,
+	CMD_PROJECTILE
+};
+
+static Command *addCommand(int type);
+
+static CommandBuffer buffers[MAX_COMMAND_BUFFERS];
+static _Thread_local CommandBuffer *currentBuffer;
+
+/*
+ * While a buffer is active on the calling thread, sounds, particles, activations,
+ * spawns and projectiles are recorded instead of being applied. They are applied later, on the
+ * main thread, by flushCommandBuffers, in buffer order.
+ */
+void beginCommandBuffer(int n)
+{
+	currentBuffer = &buffers[n];
+}
+
+void endCommandBuffer(void)
+{
+	currentBuffer = NULL;
+}
+
+int isDeferring(void)
+{
+	return currentBuffer != NULL;
+}
+
+void deferSound(int id, int channel)
+{
+	Command *c;
+
+	c = addCommand(CMD_SOUND);
+	c->id = id;
+	c->channel = channel;
+}
+
+void deferPositionalSound(int id, int channel, int srcX, int srcY, int destX, int destY)
+{
+	Command *c;
+
+	c = addCommand(CMD_POSITIONAL_SOUND);
+	c->id = id;
+	c->channel = channel;
+	c->x = srcX;
+	c->y = srcY;
+	c->destX = destX;
+	c->destY = destY;
+}
+
+void deferParticles(void (*particles)(int x, int y), int x, int y)
+{
+	Command *c;
+
+	c = addCommand(CMD_PARTICLES);
+	c->particles = particles;
+	c->x = x;
+	c->y = y;
+}
+
+void deferActivation(int target, int active)
+{
+	Command *c;
+
+	c = addCommand(CMD_ACTIVATE);
+	c->target = target;
+	c->active = active;
+}
+
+void deferSpawn(Entity *e)
+{
+	Command *c;
+
+	c = addCommand(CMD_SPAWN);
+	c->entity = e;
+}
+
+void deferProjectile(int type, float x, float y, int facing)
+{
+	Command *c;
+
+	c = addCommand(CMD_PROJECTILE);
+	c->id = type;
+	c->px = x;
+	c->py = y;
+	c->facing = facing;
+}
+
+static Command *addCommand(int type)
+{
+	CommandBuffer *b;
+	Command *c;
+	int n;
+
+	b = currentBuffer;
+
+	if (b->numCommands == b->capacity)
+	{
+		n = MAX(b->capacity * 2, INITIAL_COMMAND_CAPACITY);
+
+		b->commands = resize(b->commands, sizeof(Command) * b->capacity, sizeof(Command) * n);
+		b->capacity = n;
+	}
+
+	c = &b->commands[b->numCommands++];
+	memset(c, 0, sizeof(Command));
+	c->type = type;
+
+	return c;
+}
+
+void flushCommandBuffers(void)
+{
+	CommandBuffer *b;
+	Command *c;
+	int i, j;
+
+	for (i = 0 ; i < MAX_COMMAND_BUFFERS ; i++)
+	{
+		b = &buffers[i];
+
+		for (j = 0 ; j < b->numCommands ; j++)
+		{
+			c = &b->commands[j];
+
+			switch (c->type)
+			{
+				case CMD_SOUND:
+					playSound(c->id, c->channel);
+					break;
+
+				case CMD_POSITIONAL_SOUND:
+					playPositionalSound(c->id, c->channel, c->x, c->y, c->destX, c->destY);
+					break;
+
+				case CMD_PARTICLES:
+					c->particles(c->x, c->y);
+					break;
+
+				case CMD_ACTIVATE:
+					activeEntities(c->target, c->active);
+					break;
+
+				case CMD_PROJECTILE:
+					addProjectile(c->id, c->px, c->py, c->facing);
+					break;
+
+				default:
+					addEntity(c->entity);
+					break;
+			}
+		}
+
+		b->numCommands = 0;
+	}
+}
+
+void destroyCommandBuffers(void)
+{
+	int i;
+
+	for (i = 0 ; i < MAX_COMMAND_BUFFERS ; i++)
+	{
+		free(buffers[i].commands);
+
+		memset(&buffers[i], 0, sizeof(CommandBuffer));
+	}
+}
+
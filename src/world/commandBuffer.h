@@ -0,0 +1,31 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+void destroyCommandBuffers(void);
+void flushCommandBuffers(void);
+void deferProjectile(int type, float x, float y, int facing);
+void deferSpawn(Entity *e);
+void deferActivation(int target, int active);
+void deferParticles(void (*particles)(int x, int y), int x, int y);
+void deferPositionalSound(int id, int channel, int srcX, int srcY, int destX, int destY);
+void deferSound(int id, int channel);
+int isDeferring(void);
+void endCommandBuffer(void);
+void beginCommandBuffer(int n);
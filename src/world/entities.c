@@ -27,40 +27,120 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../world/map.h"
 #include "../system/atlas.h"
 #include "../world/entityFactory.h"
+#include "../world/entitySerialiser.h"
+#include "../world/commandBuffer.h"
+#include "../system/jobs.h"
+#include "../world/entityPool.h"
+#include "../world/targets.h"
+#include "../world/schedule.h"
+#include "../world/projectiles.h"
+#include "../system/animation.h"
+#include "../world/tileLayers.h"
+
+#define PHASED_UPDATE_MIN_ENTS    256
 
 extern App app;
-extern Entity *self;
+extern _Thread_local Entity *self;
 extern Stage stage;
 
+static void doEntitiesSerial(void);
+static void doEntitiesPhased(void);
+static void tickSlice(int slice, int numSlices);
+static Entity *resolveEntity(Entity *e, Entity *prev);
 static void move(Entity *e);
+static void resolveMove(Entity *e);
 static int push(Entity *e, float dx, float dy);
 static void moveToWorld(Entity *e, float dx, float dy);
 static void moveToEntities(Entity *e, float dx, float dy);
+static void removeEntity(Entity *e);
+static void relinkLivingClone(Entity *e);
+static void relinkDeadClone(Entity *e);
+static void resetClone(Entity *e);
 static void loadEnts(cJSON *root);
 static int canPush(Entity *e, Entity *other);
-static void drawEntityLight(Entity *e);
+static void drawEntityLight(Entity *e, float y);
 
 static Entity deadListHead, *deadListTail;
 static AtlasImage *sparkleTexture;
+static Entity **order;
+static int numOrdered;
 
-void initEntities(cJSON *root)
+/* json is the text root was parsed from, which any compiled copy of its entities must match */
+void initEntities(cJSON *root, const char *json)
 {
 	memset(&deadListHead, 0, sizeof(Entity));
 	deadListTail = &deadListHead;
 
-	loadEnts(cJSON_GetObjectItem(root, "entities"));
+	clearTargets();
+
+	if (!loadCompiledEntities(json))
+	{
+		loadEnts(cJSON_GetObjectItem(root, "entities"));
+	}
+
+	indexTargets();
+
+	reportMissingTargets();
 
 	sparkleTexture = getAtlasImage("gfx/particles/light.png", 1);
 }
 
 void doEntities(void)
+{
+	Entity *e, *riding;
+	int n;
+
+	app.dev.collisions = app.dev.ents = 0;
+
+	n = 0;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		n++;
+	}
+
+	/* must not depend on the number of cores, or the same input would play out differently between machines */
+	if (n >= PHASED_UPDATE_MIN_ENTS || app.dev.phased)
+	{
+		doEntitiesPhased();
+	}
+	else
+	{
+		doEntitiesSerial();
+	}
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		removeFromQuadtree(e, &stage.quadtree);
+
+		riding = getEntity(e->riding);
+
+		if (riding != NULL)
+		{
+			push(e, riding->dx, 0);
+		}
+
+		if (!(e->flags & (EF_NO_WORLD_CLIP|EF_NO_MAP_BOUNDS)))
+		{
+			e->x = MIN(MAX(e->x, stage.camera.minX), stage.camera.maxX - (e->w + 16));
+			e->y = MIN(MAX(e->y, 0), MAP_HEIGHT * TILE_SIZE);
+		}
+
+		addToQuadtree(e, &stage.quadtree);
+	}
+
+	doProjectiles();
+
+	updateEntityPoolStats();
+}
+
+/* the original update: each entity ticks and then moves before the next one is looked at */
+static void doEntitiesSerial(void)
 {
 	Entity *e, *prev;
 
 	prev = &stage.entityHead;
 
-	app.dev.collisions = app.dev.ents = 0;
-
 	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
 	{
 		removeFromQuadtree(e, &stage.quadtree);
@@ -69,9 +149,9 @@ void doEntities(void)
 
 		self = e;
 
-		if (e->tick)
+		if (e->def->tick)
 		{
-			e->tick();
+			e->def->tick();
 		}
 
 		if (!(e->flags & EF_STATIC))
@@ -79,52 +159,161 @@ void doEntities(void)
 			move(e);
 		}
 
-		if (e->health > 0)
+		e = prev = resolveEntity(e, prev);
+	}
+}
+
+/*
+ * Large stages tick every entity first, spread across the job threads, and then move and
+ * resolve them all serially. Anything a tick does to the rest of the world (sounds,
+ * particles, activations, spawns) is recorded in a per-slice command buffer and applied
+ * between the two phases, in slice order, so the result is the same no matter how many
+ * slices there are. Ticks that write shared state are flagged EF_SERIAL_TICK and are run
+ * on the main thread beforehand.
+ *
+ * Both phases go through the entities grouped by def (see schedule.c), rather than in the
+ * order they were spawned, so the same tick and touch code is run many times in a row.
+ */
+static void doEntitiesPhased(void)
+{
+	Entity *e, *prev;
+	int i;
+
+	order = scheduleEntities(&numOrdered);
+
+	/* ticks are free to reposition themselves, so nothing can be left in the quadtree */
+	for (i = 0 ; i < numOrdered ; i++)
+	{
+		removeFromQuadtree(order[i], &stage.quadtree);
+	}
+
+	beginCommandBuffer(0);
+
+	for (i = 0 ; i < numOrdered ; i++)
+	{
+		e = order[i];
+
+		if (e->def->tick && e->flags & EF_SERIAL_TICK)
 		{
-			addToQuadtree(e, &stage.quadtree);
+			self = e;
+
+			e->def->tick();
 		}
-		else
+	}
+
+	endCommandBuffer();
+
+	runJobs(tickSlice);
+
+	flushCommandBuffers();
+
+	/* scheduled again, as the ticks can have spawned something new */
+	order = scheduleEntities(&numOrdered);
+
+	for (i = 0 ; i < numOrdered ; i++)
+	{
+		addToQuadtree(order[i], &stage.quadtree);
+	}
+
+	for (i = 0 ; i < numOrdered ; i++)
+	{
+		e = order[i];
+
+		app.dev.ents++;
+
+		if (!(e->flags & EF_STATIC))
 		{
-			if (e->die)
-			{
-				e->die();
-			}
+			removeFromQuadtree(e, &stage.quadtree);
 
-			if (e == stage.entityTail)
-			{
-				stage.entityTail = prev;
-			}
+			self = e;
 
-			prev->next = e->next;
+			move(e);
 
-			/* add to dead list */
-			deadListTail->next = e;
-			deadListTail = e;
-			deadListTail->next = NULL;
+			addToQuadtree(e, &stage.quadtree);
+		}
+	}
 
-			e = prev;
+	/* deaths are resolved in list order, as the serial update does */
+	prev = &stage.entityHead;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		if (e->health <= 0)
+		{
+			removeFromQuadtree(e, &stage.quadtree);
+
+			self = e;
+
+			e = resolveEntity(e, prev);
 		}
 
 		prev = e;
 	}
+}
 
-	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+static void tickSlice(int slice, int numSlices)
+{
+	Entity *e;
+	int i, start, end;
+
+	start = (numOrdered * slice) / numSlices;
+	end = (numOrdered * (slice + 1)) / numSlices;
+
+	beginCommandBuffer(slice + 1);
+
+	for (i = start ; i < end ; i++)
 	{
-		removeFromQuadtree(e, &stage.quadtree);
+		e = order[i];
 
-		if (e->riding != NULL)
+		if (e->def->tick && !(e->flags & EF_SERIAL_TICK))
 		{
-			push(e, e->riding->dx, 0);
-		}
+			self = e;
 
-		if (!(e->flags & (EF_NO_WORLD_CLIP|EF_NO_MAP_BOUNDS)))
-		{
-			e->x = MIN(MAX(e->x, stage.camera.minX), stage.camera.maxX - (e->w + 16));
-			e->y = MIN(MAX(e->y, 0), MAP_HEIGHT * TILE_SIZE);
+			e->def->tick();
 		}
+	}
 
+	endCommandBuffer();
+}
+
+/* returns the entity that now precedes the next one in the list */
+static Entity *resolveEntity(Entity *e, Entity *prev)
+{
+	if (e->health > 0)
+	{
 		addToQuadtree(e, &stage.quadtree);
+
+		return e;
 	}
+
+	if (e->def->die)
+	{
+		e->def->die();
+	}
+
+	if (e == stage.entityTail)
+	{
+		stage.entityTail = prev;
+	}
+
+	prev->next = e->next;
+
+	/* clones are brought back when the stage resets, and the camera stays where the player fell */
+	if (e->def->type == ET_PLAYER || e->def->type == ET_CLONE)
+	{
+		removeFromTypeList(e);
+
+		addDeadEntity(e);
+	}
+	else
+	{
+		removeFromTypeList(e);
+
+		freeComponent(e->data);
+		freeEntity(e);
+	}
+
+	return prev;
 }
 
 static void move(Entity *e)
@@ -135,12 +324,21 @@ static void move(Entity *e)
 		e->dy = MAX(MIN(e->dy, 18), -999);
 	}
 
-	if (e->riding != NULL && e->riding->dy > 0)
+	resolveMove(e);
+}
+
+static void resolveMove(Entity *e)
+{
+	Entity *riding;
+
+	riding = getEntity(e->riding);
+
+	if (riding != NULL && riding->dy > 0)
 	{
-		e->dy = e->riding->dy + 1;
+		e->dy = riding->dy + 1;
 	}
 
-	e->riding = NULL;
+	e->riding = getEntityHandle(NULL);
 
 	e->isOnGround = 0;
 
@@ -161,6 +359,11 @@ static int push(Entity *e, float dx, float dy)
 
 	moveToEntities(e, dx, dy);
 
+	if (isWalter(e) && touchingHazard(e->x, e->y, e->w, e->h))
+	{
+		e->health = 0;
+	}
+
 	if (!(e->flags & EF_NO_WORLD_CLIP))
 	{
 		moveToWorld(e, dx, dy);
@@ -239,9 +442,9 @@ static void moveToWorld(Entity *e, float dx, float dy)
 		}
 	}
 
-	if (hit && e->touch)
+	if (hit && e->def->touch)
 	{
-		e->touch(NULL);
+		e->def->touch(NULL);
 	}
 }
 
@@ -326,7 +529,7 @@ static void moveToEntities(Entity *e, float dx, float dy)
 
 							if (!(e->flags & EF_WEIGHTLESS))
 							{
-								e->riding = other;
+								e->riding = getEntityHandle(other);
 							}
 						}
 					}
@@ -342,18 +545,18 @@ static void moveToEntities(Entity *e, float dx, float dy)
 				}
 			}
 
-			if (e->touch)
+			if (e->def->touch)
 			{
-				e->touch(other);
+				e->def->touch(other);
 			}
 
-			if (other->flags & EF_STATIC && other->touch)
+			if (other->flags & EF_STATIC && other->def->touch)
 			{
 				oldSelf = self;
 
 				self = other;
 
-				other->touch(e);
+				other->def->touch(e);
 
 				self = oldSelf;
 			}
@@ -408,9 +611,46 @@ void dropToFloor(void)
 	}
 }
 
+/* once everything has dropped to the floor, whatever never moves or changes becomes part of the map */
+void bakeEntities(void)
+{
+	Entity *e, *prev;
+
+	clearTileLayers();
+
+	prev = &stage.entityHead;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		if (e->def->tileLayer != TL_NONE)
+		{
+			addTileSprite(e->def->tileLayer, e->atlasImage, e->x, e->y, e->facing == FACING_LEFT);
+
+			prev->next = e->next;
+
+			if (e == stage.entityTail)
+			{
+				stage.entityTail = prev;
+			}
+
+			removeEntity(e);
+
+			e = prev;
+		}
+		else
+		{
+			prev = e;
+		}
+	}
+
+	indexTileLayers();
+}
+
 void drawEntities(int background)
 {
 	Entity *e, *candidates[MAX_QT_CANDIDATES];
+	AtlasImage *image;
+	float y;
 	int i;
 
 	getAllEntsWithin(stage.camera.x, stage.camera.y, SCREEN_WIDTH, SCREEN_HEIGHT, candidates, NULL);
@@ -421,158 +661,284 @@ void drawEntities(int background)
 		{
 			app.dev.drawing++;
 
+			image = e->atlasImage;
+			y = e->y;
+
+			if (e->anim != NULL)
+			{
+				image = getAnimFrame(e);
+				y += getAnimBob(e);
+			}
+
 			if (e->light.a > 0 && !e->light.foreground)
 			{
-				drawEntityLight(e);
+				drawEntityLight(e, y);
 			}
 
-			blitAtlasImage(e->atlasImage, e->x - stage.camera.x, e->y - stage.camera.y, 0, e->facing == FACING_LEFT ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+			blitAtlasImage(image, e->x - stage.camera.x, y - stage.camera.y, 0, e->facing == FACING_LEFT ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
 
 			if (e->light.a > 0 && e->light.foreground)
 			{
-				drawEntityLight(e);
+				drawEntityLight(e, y);
 			}
 		}
 	}
+
+	drawProjectiles(background);
 }
 
-static void drawEntityLight(Entity *e)
+static void drawEntityLight(Entity *e, float y)
 {
-	int x, y;
+	SDL_Color c;
+	int lx, ly;
 
 	if (e->light.a > 0)
 	{
-		x =  e->x + (e->w / 2) + e->light.x - stage.camera.x;
-		y =  e->y + (e->h / 2) + e->light.y - stage.camera.y;
+		lx =  e->x + (e->w / 2) + e->light.x - stage.camera.x;
+		ly =  y + (e->h / 2) + e->light.y - stage.camera.y;
 
-		SDL_SetTextureColorMod(sparkleTexture->texture, e->light.r, e->light.g, e->light.b);
-		SDL_SetTextureAlphaMod(sparkleTexture->texture, e->light.a);
+		c.r = e->light.r;
+		c.g = e->light.g;
+		c.b = e->light.b;
+		c.a = e->light.a;
 
-		blitAtlasImage(sparkleTexture, x, y, 1, SDL_FLIP_NONE);
-
-		SDL_SetTextureColorMod(sparkleTexture->texture, 255, 255, 255);
-		SDL_SetTextureAlphaMod(sparkleTexture->texture, 255);
+		blitTintedAtlasImage(sparkleTexture, lx, ly, 1, SDL_FLIP_NONE, c);
 	}
 }
 
-void activeEntities(char *targetName, int active)
+void activeEntities(int target, int active)
 {
 	Entity *e, *oldSelf;
+	Target *t;
+	int i;
+
+	if (isDeferring())
+	{
+		deferActivation(target, active);
+		return;
+	}
+
+	t = getTarget(target);
 
 	oldSelf = self;
 
-	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	for (i = 0 ; i < t->numEnts ; i++)
 	{
-		if (e->activate && strcmp(e->name, targetName) == 0)
+		/* anything that has since been destroyed is simply skipped */
+		e = getEntity(t->ents[i]);
+
+		if (e != NULL)
 		{
 			self = e;
 
-			e->activate(active);
+			e->def->activate(active);
 		}
 	}
 
 	self = oldSelf;
 }
 
-void resetEntities(void)
+void addToTypeList(Entity *e)
 {
-	Entity *e, *prev;
+	int type;
+
+	type = e->def->type;
 
-	/* append deadlist to main list before reset */
-	if (deadListHead.next)
+	e->typePrev = stage.typeTail[type];
+	e->typeNext = NULL;
+
+	if (stage.typeTail[type] != NULL)
+	{
+		stage.typeTail[type]->typeNext = e;
+	}
+	else
 	{
-		stage.entityTail->next = deadListHead.next;
-		stage.entityTail = deadListTail;
-		deadListHead.next = NULL;
+		stage.typeHead[type] = e;
 	}
 
-	prev = &stage.entityHead;
+	stage.typeTail[type] = e;
+}
 
-	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+void removeFromTypeList(Entity *e)
+{
+	int type;
+
+	type = e->def->type;
+
+	if (e->typePrev != NULL)
 	{
-		if (e->type != ET_CLONE)
-		{
-			if (e->health > 0)
-			{
-				removeFromQuadtree(e, &stage.quadtree);
-			}
+		e->typePrev->typeNext = e->typeNext;
+	}
+	else
+	{
+		stage.typeHead[type] = e->typeNext;
+	}
 
-			if (e == stage.entityTail)
-			{
-				stage.entityTail = prev;
-			}
+	if (e->typeNext != NULL)
+	{
+		e->typeNext->typePrev = e->typePrev;
+	}
+	else
+	{
+		stage.typeTail[type] = e->typePrev;
+	}
 
-			prev->next = e->next;
-			free(e->data);
-			free(e);
-			e = prev;
-		}
+	e->typePrev = e->typeNext = NULL;
+}
 
-		prev = e;
+/* fn may remove the entity it is given */
+void forEachEntityOfType(int type, void (*fn)(Entity *e))
+{
+	Entity *e, *next;
+
+	for (e = stage.typeHead[type] ; e != NULL ; e = next)
+	{
+		next = e->typeNext;
+
+		fn(e);
 	}
 }
 
-void resetClones(void)
+/* kept in the order they died, in the type lists too, for resetEntities */
+void addDeadEntity(Entity *e)
+{
+	deadListTail->next = e;
+	deadListTail = e;
+	deadListTail->next = NULL;
+
+	addToTypeList(e);
+}
+
+Entity *getDeadEntities(void)
+{
+	return deadListHead.next;
+}
+
+/* everything goes back to the pools, clones and the dead included */
+void clearEntities(void)
+{
+	int type;
+
+	for (type = 0 ; type < ET_MAX ; type++)
+	{
+		forEachEntityOfType(type, removeEntity);
+	}
+
+	stage.entityHead.next = NULL;
+	stage.entityTail = &stage.entityHead;
+
+	deadListHead.next = NULL;
+	deadListTail = &deadListHead;
+
+	clearProjectiles();
+}
+
+void resetEntities(void)
 {
 	Entity *e;
-	Walter *c;
+	int type;
 
-	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	for (type = 0 ; type < ET_MAX ; type++)
 	{
-		if (e->type == ET_CLONE)
+		if (type != ET_CLONE)
 		{
-			removeFromQuadtree(e, &stage.quadtree);
+			forEachEntityOfType(type, removeEntity);
+		}
+	}
 
-			e->x = stage.player->x;
-			e->y = stage.player->y;
-			e->health = 1;
+	/* only the clones are left: the living ones, followed by the dead ones in the order they died */
+	stage.entityHead.next = NULL;
+	stage.entityTail = &stage.entityHead;
 
-			c = (Walter*)e->data;
-			c->equipment = EQ_NONE;
-			c->pData = NULL;
-			c->advanceData = 1;
+	deadListHead.next = NULL;
+	deadListTail = &deadListHead;
 
-			addToQuadtree(e, &stage.quadtree);
-		}
+	forEachEntityOfType(ET_CLONE, relinkLivingClone);
+
+	forEachEntityOfType(ET_CLONE, relinkDeadClone);
+
+	stage.typeHead[ET_CLONE] = stage.typeTail[ET_CLONE] = NULL;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		addToTypeList(e);
 	}
+
+	clearProjectiles();
 }
 
-void destroyEntities(void)
+static void removeEntity(Entity *e)
 {
-	Entity *e;
-	Walter *c;
-	CloneData *cd;
+	/* one that died this frame is still in the quadtree, until the deaths are resolved */
+	removeFromQuadtree(e, &stage.quadtree);
 
-	while (stage.entityHead.next)
-	{
-		e = stage.entityHead.next;
-		stage.entityHead.next = e->next;
+	removeFromTypeList(e);
 
-		if (e->type == ET_CLONE)
-		{
-			c = (Walter*)e->data;
+	freeComponent(e->data);
+	freeEntity(e);
+}
 
-			while (c->dataHead)
-			{
-				cd = c->dataHead;
-				c->dataHead = cd->next;
-				free(cd);
-			}
-		}
+static void relinkLivingClone(Entity *e)
+{
+	if (e->health > 0)
+	{
+		stage.entityTail->next = e;
+		stage.entityTail = e;
 
-		free(e->data);
-		free(e);
+		e->next = NULL;
 	}
+}
 
-	while (deadListHead.next)
+static void relinkDeadClone(Entity *e)
+{
+	if (e->health <= 0)
 	{
-		e = deadListHead.next;
-		deadListHead.next = e->next;
-		free(e->data);
-		free(e);
+		stage.entityTail->next = e;
+		stage.entityTail = e;
+
+		e->next = NULL;
 	}
 }
 
+void resetClones(void)
+{
+	forEachEntityOfType(ET_CLONE, resetClone);
+}
+
+static void resetClone(Entity *e)
+{
+	Walter *c;
+
+	removeFromQuadtree(e, &stage.quadtree);
+
+	e->x = getPlayer()->x;
+	e->y = getPlayer()->y;
+	e->health = 1;
+
+	c = (Walter*)e->data;
+	c->equipment = EQ_NONE;
+	c->playing = 1;
+
+	addToQuadtree(e, &stage.quadtree);
+}
+
+/* the entities and their data are handed back in bulk by resetEntityPools() */
+void destroyEntities(void)
+{
+	stage.entityHead.next = NULL;
+	stage.entityTail = &stage.entityHead;
+
+	memset(stage.typeHead, 0, sizeof(Entity*) * ET_MAX);
+	memset(stage.typeTail, 0, sizeof(Entity*) * ET_MAX);
+
+	deadListHead.next = NULL;
+	deadListTail = &deadListHead;
+
+	clearProjectiles();
+
+	clearTileLayers();
+}
+
 static void loadEnts(cJSON *root)
 {
 	cJSON *node;
@@ -21,8 +21,15 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 void destroyEntities(void);
 void resetClones(void);
 void resetEntities(void);
-void activeEntities(char *targetName, int active);
+void clearEntities(void);
+Entity *getDeadEntities(void);
+void addDeadEntity(Entity *e);
+void forEachEntityOfType(int type, void (*fn)(Entity *e));
+void removeFromTypeList(Entity *e);
+void addToTypeList(Entity *e);
+void activeEntities(int target, int active);
 void drawEntities(int background);
+void bakeEntities(void);
 void dropToFloor(void);
 void doEntities(void);
-void initEntities(cJSON *root);
+void initEntities(cJSON *root, const char *json);
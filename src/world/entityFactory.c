@@ -42,122 +42,281 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../entities/toilet.h"
 #include "../entities/waterPistol.h"
 #include "../entities/spikes.h"
-
-extern Entity *self;
+#include "../entities/clone.h"
+#include "../entities/partner.h"
+#include "../world/commandBuffer.h"
+#include "../world/entityPool.h"
+#include "../world/entities.h"
+#include "../world/entitySerialiser.h"
+
+extern _Thread_local Entity *self;
 extern Stage stage;
 
-static void addInitFunc(const char *id, void (*init)(Entity *e));
+static void addPrototype(const char *id, void (*initPrototype)(Entity *e), void (*init)(Entity *e));
+static Prototype *getPrototype(const char *type);
 
-static InitFunc initFuncHead, *initFuncTail;
+static Prototype prototypeHead, *prototypeTail;
 static unsigned long entityId;
 
 void initEntityFactory(void)
 {
-	memset(&initFuncHead, 0, sizeof(InitFunc));
-	initFuncTail = &initFuncHead;
-
-	addInitFunc("player", initPlayer);
-	addInitFunc("coin", initCoin);
-	addInitFunc("toilet", initToilet);
-	addInitFunc("plunger", initPlunger);
-	addInitFunc("key", initKey);
-	addInitFunc("door", initDoor);
-	addInitFunc("spikes", initSpikes);
-	addInitFunc("roofSpikes", initRoofSpikes);
-	addInitFunc("spitter", initSpitter);
-	addInitFunc("manholeCover", initManholeCover);
-	addInitFunc("trafficLight", initTrafficLight);
-	addInitFunc("item", initItem);
-	addInitFunc("platform", initPlatform);
-	addInitFunc("pressurePlate", initPressurePlate);
-	addInitFunc("pushBlock", initPushBlock);
-	addInitFunc("slimeDrip", initSlimeDrip);
-	addInitFunc("waterPistol", initWaterPistol);
-	addInitFunc("waterButton", initWaterButton);
-	addInitFunc("finalToilet", initFinalToilet);
-	addInitFunc("vomitToilet", initVomitToilet);
-	addInitFunc("decoration", initDecoration);
+	memset(&prototypeHead, 0, sizeof(Prototype));
+	prototypeTail = &prototypeHead;
+
+	addPrototype("player", initPlayerPrototype, initPlayer);
+	addPrototype("coin", initCoinPrototype, initCoin);
+	addPrototype("toilet", initToiletPrototype, initToilet);
+	addPrototype("plunger", initPlungerPrototype, initPlunger);
+	addPrototype("key", initKeyPrototype, initKey);
+	addPrototype("door", initDoorPrototype, initDoor);
+	addPrototype("spikes", initSpikesPrototype, NULL);
+	addPrototype("roofSpikes", initRoofSpikesPrototype, NULL);
+	addPrototype("spitter", initSpitterPrototype, initSpitter);
+	addPrototype("manholeCover", initManholeCoverPrototype, initManholeCover);
+	addPrototype("trafficLight", initTrafficLightPrototype, initTrafficLight);
+	addPrototype("item", initItemPrototype, initItem);
+	addPrototype("platform", initPlatformPrototype, initPlatform);
+	addPrototype("pressurePlate", initPressurePlatePrototype, initPressurePlate);
+	addPrototype("pushBlock", initPushBlockPrototype, NULL);
+	addPrototype("slimeDrip", initSlimeDripPrototype, initSlimeDrip);
+	addPrototype("waterPistol", initWaterPistolPrototype, initWaterPistol);
+	addPrototype("waterButton", initWaterButtonPrototype, initWaterButton);
+	addPrototype("finalToilet", initFinalToiletPrototype, initFinalToilet);
+	addPrototype("vomitToilet", initVomitToiletPrototype, NULL);
+	addPrototype("decoration", initDecorationPrototype, initDecoration);
+
+	/* spawned by the player rather than placed, so not one of the stage's types */
+	initClonePrototype();
+
+	initPartnerPrototype();
 
 	entityId = 0;
 }
 
-static void addInitFunc(const char *id, void (*init)(Entity *e))
+/* the atlas lookups and defaults shared by every instance are done here, once, rather than on every spawn */
+static void addPrototype(const char *id, void (*initPrototype)(Entity *e), void (*init)(Entity *e))
+{
+	Prototype *p;
+
+	p = malloc(sizeof(Prototype));
+	memset(p, 0, sizeof(Prototype));
+	prototypeTail->next = p;
+	prototypeTail = p;
+
+	STRNCPY(p->id, id, MAX_NAME_LENGTH);
+	p->init = init;
+
+	initPrototype(&p->entity);
+}
+
+static Prototype *getPrototype(const char *type)
 {
-	InitFunc *initFunc;
+	Prototype *p;
 
-	initFunc = malloc(sizeof(InitFunc));
-	memset(initFunc, 0, sizeof(InitFunc));
-	initFuncTail->next = initFunc;
-	initFuncTail = initFunc;
+	for (p = prototypeHead.next ; p != NULL ; p = p->next)
+	{
+		if (strcmp(p->id, type) == 0)
+		{
+			return p;
+		}
+	}
+
+	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Unknown entity type '%s'", type);
+	exit(1);
 
-	STRNCPY(initFunc->id, id, MAX_NAME_LENGTH);
-	initFunc->init = init;
+	return NULL;
 }
 
 Entity *spawnEntity(void)
 {
 	Entity *e;
 
-	e = malloc(sizeof(Entity));
-	memset(e, 0, sizeof(Entity));
-	stage.entityTail->next = e;
-	stage.entityTail = e;
+	e = allocEntity();
+
+	e->health = 1;
+
+	return e;
+}
+
+Entity *spawnPrototype(Entity *prototype)
+{
+	Entity *e;
+
+	e = allocEntity();
+
+	*e = *prototype;
 
-	e->id = ++entityId;
 	e->health = 1;
 
 	return e;
 }
 
+/* called once the entity has been set up, as it can only join its type's list when its type is known */
+void addEntity(Entity *e)
+{
+	/* linked in when the command buffer is flushed, so ids stay in a deterministic order */
+	if (isDeferring())
+	{
+		deferSpawn(e);
+
+		return;
+	}
+
+	linkEntity(e);
+
+	e->id = ++entityId;
+}
+
+/* for an entity that already has its id, such as one put back from a snapshot */
+void linkEntity(Entity *e)
+{
+	stage.entityTail->next = e;
+	stage.entityTail = e;
+
+	addToTypeList(e);
+}
+
+unsigned long getLastEntityId(void)
+{
+	return entityId;
+}
+
+void setLastEntityId(unsigned long id)
+{
+	entityId = id;
+}
+
+/* the type, position and name are picked up in the same walk that sets the fields aside, so the object is only scanned once, ignoring case as cJSON does */
 void initEntity(cJSON *root)
 {
-	char *type;
-	InitFunc *initFunc;
 	Entity *e;
+	cJSON *node, *fields[MAX_ENTITY_FIELDS];
+	char *type, *name;
+	int x, y, numFields;
 
-	type = cJSON_GetObjectItem(root, "type")->valuestring;
+	type = NULL;
+	name = "";
+	x = y = numFields = 0;
 
-	for (initFunc = initFuncHead.next ; initFunc != NULL ; initFunc = initFunc->next)
+	for (node = root->child ; node != NULL ; node = node->next)
 	{
-		if (strcmp(initFunc->id, type) == 0)
+		if (SDL_strcasecmp(node->string, "type") == 0)
+		{
+			type = node->valuestring;
+		}
+		else if (SDL_strcasecmp(node->string, "x") == 0)
+		{
+			x = node->valueint;
+		}
+		else if (SDL_strcasecmp(node->string, "y") == 0)
+		{
+			y = node->valueint;
+		}
+		else if (SDL_strcasecmp(node->string, "name") == 0)
+		{
+			name = node->valuestring;
+		}
+		else if (numFields < MAX_ENTITY_FIELDS)
 		{
-			e = spawnEntity();
+			fields[numFields++] = node;
+		}
+		else
+		{
+			SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Entity '%s' has too many fields", name);
+			exit(1);
+		}
+	}
+
+	if (type == NULL)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Entity '%s' has no type", name);
+		exit(1);
+	}
+
+	e = createStageEntity(getPrototype(type), x, y, name);
+
+	readEntityJSON(e, fields, numFields);
+
+	loadStageEntity(e);
+}
+
+/* the entity a stage places, before the values its type reads from the stage have been filled in */
+Entity *createStageEntity(Prototype *p, int x, int y, const char *name)
+{
+	Entity *e;
+
+	e = spawnPrototype(&p->entity);
+
+	e->x = x;
+	e->y = y;
+
+	STRNCPY(e->name, name, MAX_NAME_LENGTH);
+
+	if (p->init)
+	{
+		p->init(e);
+	}
+
+	return e;
+}
+
+/* once its fields have been read, from the stage's JSON or its compiled entities */
+void loadStageEntity(Entity *e)
+{
+	if (e->def->load)
+	{
+		self = e;
+
+		e->def->load();
+	}
 
-			e->x = cJSON_GetObjectItem(root, "x")->valueint;
-			e->y = cJSON_GetObjectItem(root, "y")->valueint;
+	addEntity(e);
+}
 
-			if (cJSON_GetObjectItem(root, "name"))
-			{
-				STRNCPY(e->name, cJSON_GetObjectItem(root, "name")->valuestring, MAX_NAME_LENGTH);
-			}
+/* the types a stage can place, in the order they were added, which is how compiled stages refer to them */
+Prototype *getStagePrototype(int index)
+{
+	Prototype *p;
 
-			initFunc->init(e);
+	for (p = prototypeHead.next ; p != NULL && index > 0 ; p = p->next)
+	{
+		index--;
+	}
 
-			if (e->load)
-			{
-				self = e;
+	return index == 0 ? p : NULL;
+}
+
+/* -1 for those a stage can't place, such as clones */
+int getStagePrototypeIndex(EntityDef *def)
+{
+	Prototype *p;
+	int i;
 
-				e->load(root);
-			}
+	i = 0;
 
-			return;
+	for (p = prototypeHead.next ; p != NULL ; p = p->next)
+	{
+		if (p->entity.def == def)
+		{
+			return i;
 		}
+
+		i++;
 	}
 
-	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Unknown entity type '%s'", type);
-	exit(1);
+	return -1;
 }
 
 /* used by map editor */
 Entity **initAllEnts(int *numEnts)
 {
 	Entity *e, **allEnts;
-	InitFunc *initFunc;
+	Prototype *p;
 	int i;
 
 	*numEnts = 0;
 
-	for (initFunc = initFuncHead.next ; initFunc != NULL ; initFunc = initFunc->next)
+	for (p = prototypeHead.next ; p != NULL ; p = p->next)
 	{
 		*numEnts = *numEnts + 1;
 	}
@@ -166,12 +325,16 @@ Entity **initAllEnts(int *numEnts)
 
 	i = 0;
 
-	for (initFunc = initFuncHead.next ; initFunc != NULL ; initFunc = initFunc->next)
+	for (p = prototypeHead.next ; p != NULL ; p = p->next)
 	{
-		e = malloc(sizeof(Entity));
-		memset(e, 0, sizeof(Entity));
+		e = allocEntity();
 
-		initFunc->init(e);
+		*e = p->entity;
+
+		if (p->init)
+		{
+			p->init(e);
+		}
 
 		allEnts[i++] = e;
 	}
@@ -181,27 +344,24 @@ Entity **initAllEnts(int *numEnts)
 
 Entity *spawnEditorEntity(const char *type, int x, int y)
 {
-	InitFunc *initFunc;
+	Prototype *p;
 	Entity *e;
 
-	for (initFunc = initFuncHead.next ; initFunc != NULL ; initFunc = initFunc->next)
-	{
-		if (strcmp(initFunc->id, type) == 0)
-		{
-			e = spawnEntity();
-
-			e->x = x;
-			e->y = y;
+	p = getPrototype(type);
 
-			initFunc->init(e);
+	e = spawnPrototype(&p->entity);
 
-			e->flags &= ~EF_INVISIBLE;
+	e->x = x;
+	e->y = y;
 
-			return e;
-		}
+	if (p->init)
+	{
+		p->init(e);
 	}
 
-	SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Unknown entity type '%s'", type);
-	exit(1);
-}
+	e->flags &= ~EF_INVISIBLE;
 
+	addEntity(e);
+
+	return e;
+}
@@ -20,6 +20,15 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 Entity *spawnEditorEntity(const char *type, int x, int y);
 Entity **initAllEnts(int *numEnts);
+int getStagePrototypeIndex(EntityDef *def);
+Prototype *getStagePrototype(int index);
+void loadStageEntity(Entity *e);
+Entity *createStageEntity(Prototype *p, int x, int y, const char *name);
 void initEntity(cJSON *root);
+void setLastEntityId(unsigned long id);
+unsigned long getLastEntityId(void);
+void linkEntity(Entity *e);
+void addEntity(Entity *e);
+Entity *spawnPrototype(Entity *prototype);
 Entity *spawnEntity(void);
 void initEntityFactory(void);
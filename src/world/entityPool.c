@@ -0,0 +1,160 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "entityPool.h"
+#include "../system/pool.h"
+
+extern App app;
+extern Stage stage;
+
+static Pool entityPool;
+static Pool componentPools[CP_MAX];
+
+void initEntityPools(void)
+{
+	initPool(&entityPool, "Entity", sizeof(Entity), 128);
+
+	initPool(&componentPools[CP_WALTER], "Walter", sizeof(Walter), 16);
+	initPool(&componentPools[CP_TOILET], "Toilet", sizeof(Toilet), 16);
+	initPool(&componentPools[CP_SPITTER], "Spitter", sizeof(Spitter), 16);
+	initPool(&componentPools[CP_ITEM], "Item", sizeof(Item), 8);
+	initPool(&componentPools[CP_PLATFORM], "Platform", sizeof(Platform), 16);
+	initPool(&componentPools[CP_TRAFFIC_LIGHT], "TrafficLight", sizeof(TrafficLight), 8);
+	initPool(&componentPools[CP_DECORATION], "Decoration", sizeof(Decoration), 16);
+	initPool(&componentPools[CP_DOOR], "Door", sizeof(Door), 16);
+	initPool(&componentPools[CP_WATER_BUTTON], "WaterButton", sizeof(WaterButton), 8);
+	initPool(&componentPools[CP_PRESSURE_PLATE], "PressurePlate", sizeof(PressurePlate), 8);
+}
+
+Entity *allocEntity(void)
+{
+	return allocPoolItem(&entityPool);
+}
+
+void freeEntity(Entity *e)
+{
+	freePoolItem(e);
+}
+
+EntityHandle getEntityHandle(Entity *e)
+{
+	EntityHandle handle;
+
+	memset(&handle, 0, sizeof(EntityHandle));
+
+	if (e != NULL)
+	{
+		handle.index = getPoolItemIndex(e);
+		handle.generation = getPoolItemGeneration(e);
+	}
+
+	return handle;
+}
+
+/* NULL once the entity has been freed */
+Entity *getEntity(EntityHandle handle)
+{
+	return getPoolItem(&entityPool, handle.index, handle.generation);
+}
+
+Entity *getPlayer(void)
+{
+	return getEntity(stage.player);
+}
+
+Entity *getPartner(void)
+{
+	return getEntity(stage.partner);
+}
+
+/* the player, their clones, or a co-op partner: anything that picks things up and can be hurt */
+int isWalter(Entity *e)
+{
+	return e->def->type == ET_PLAYER || e->def->type == ET_CLONE || e->def->type == ET_PARTNER;
+}
+
+void *allocComponent(int type)
+{
+	return allocPoolItem(&componentPools[type]);
+}
+
+void freeComponent(void *data)
+{
+	freePoolItem(data);
+}
+
+/* which CP_ pool the data came from */
+int getComponentType(void *data)
+{
+	return getPoolItemPool(data) - componentPools;
+}
+
+int getComponentSize(int type)
+{
+	return componentPools[type].itemSize;
+}
+
+const char *getComponentName(int type)
+{
+	return componentPools[type].name;
+}
+
+void updateEntityPoolStats(void)
+{
+	int i;
+
+	app.dev.pooledEnts = entityPool.live;
+	app.dev.peakEnts = entityPool.peak;
+
+	app.dev.pooledData = app.dev.peakData = 0;
+
+	for (i = 0 ; i < CP_MAX ; i++)
+	{
+		app.dev.pooledData += componentPools[i].live;
+		app.dev.peakData += componentPools[i].peak;
+	}
+}
+
+/* everything the stage allocated goes back in one go, rather than entity by entity */
+void resetEntityPools(void)
+{
+	int i;
+
+	resetPool(&entityPool);
+
+	for (i = 0 ; i < CP_MAX ; i++)
+	{
+		resetPool(&componentPools[i]);
+	}
+}
+
+void destroyEntityPools(void)
+{
+	int i;
+
+	destroyPool(&entityPool);
+
+	for (i = 0 ; i < CP_MAX ; i++)
+	{
+		destroyPool(&componentPools[i]);
+	}
+}
+
@@ -0,0 +1,36 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+void destroyEntityPools(void);
+void resetEntityPools(void);
+void updateEntityPoolStats(void);
+const char *getComponentName(int type);
+int getComponentSize(int type);
+int getComponentType(void *data);
+void freeComponent(void *data);
+void *allocComponent(int type);
+int isWalter(Entity *e);
+Entity *getPartner(void);
+Entity *getPlayer(void);
+Entity *getEntity(EntityHandle handle);
+EntityHandle getEntityHandle(Entity *e);
+void freeEntity(Entity *e);
+Entity *allocEntity(void);
+void initEntityPools(void);
@@ -0,0 +1,515 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "entitySerialiser.h"
+#include "../json/cJSON.h"
+#include "../system/io.h"
+#include "../world/entityFactory.h"
+#include "../world/snapshot.h"
+#include "../world/stage.h"
+
+extern App app;
+extern Stage stage;
+
+static void readFieldJSON(Entity *e, EntityField *f, cJSON *node);
+static void writeFieldJSON(Entity *e, EntityField *f, cJSON *root);
+static void serialiseEntity(Entity *e, int type, Snapshot *s);
+static Entity *deserialiseEntity(void);
+static char *getField(Entity *e, EntityField *f);
+static void writeInt(Snapshot *s, int value);
+static void writeString(Snapshot *s, char *value);
+static int readInt(void);
+static int readByte(void);
+static void readString(char *dest);
+static unsigned int getSchema(void);
+static unsigned int hashBytes(unsigned int hash, const void *data, int n);
+static void getCompiledFilename(char *filename);
+
+static char *cursor;
+static char *end;
+
+/*
+ * An entity's stage values are described by its def's field table, which is read and written
+ * both as the JSON the editor authors, and as compiled little endian records that can be read
+ * straight off, without cJSON's linear, case insensitive, lookup of every name. A compiled
+ * record is the type's index, x, y and name, followed by its fields in the order of its table.
+ */
+void readEntityJSON(Entity *e, cJSON **nodes, int numNodes)
+{
+	EntityField *f;
+	int i;
+
+	/* the nodes are those initEntity set aside in its one pass over the object */
+	for (i = 0 ; i < numNodes ; i++)
+	{
+		for (f = e->def->fields ; f < e->def->fields + e->def->numFields ; f++)
+		{
+			if (SDL_strcasecmp(f->name, nodes[i]->string) == 0)
+			{
+				readFieldJSON(e, f, nodes[i]);
+
+				break;
+			}
+		}
+	}
+}
+
+static void readFieldJSON(Entity *e, EntityField *f, cJSON *node)
+{
+	switch (f->type)
+	{
+		case FT_INT:
+			*((int*)getField(e, f)) = node->valueint;
+			break;
+
+		case FT_FLOAT:
+			*((float*)getField(e, f)) = node->valuedouble;
+			break;
+
+		case FT_STRING:
+			STRNCPY(getField(e, f), node->valuestring, MAX_NAME_LENGTH);
+			break;
+
+		/* set by being there */
+		case FT_FLAG:
+			*((int*)getField(e, f)) = 1;
+			break;
+
+		case FT_FACING:
+			e->facing = strcmp(node->valuestring, "left") == 0 ? 0 : 1;
+			break;
+
+		default:
+			break;
+	}
+}
+
+void writeEntityJSON(Entity *e, cJSON *root)
+{
+	int i;
+
+	cJSON_AddStringToObject(root, "type", e->def->typeName);
+	cJSON_AddNumberToObject(root, "x", e->x);
+	cJSON_AddNumberToObject(root, "y", e->y);
+
+	if (strlen(e->name) > 0)
+	{
+		cJSON_AddStringToObject(root, "name", e->name);
+	}
+
+	for (i = 0 ; i < e->def->numFields ; i++)
+	{
+		writeFieldJSON(e, &e->def->fields[i], root);
+	}
+}
+
+static void writeFieldJSON(Entity *e, EntityField *f, cJSON *root)
+{
+	switch (f->type)
+	{
+		case FT_INT:
+			cJSON_AddNumberToObject(root, f->name, *((int*)getField(e, f)));
+			break;
+
+		case FT_FLOAT:
+			cJSON_AddNumberToObject(root, f->name, *((float*)getField(e, f)));
+			break;
+
+		case FT_STRING:
+			cJSON_AddStringToObject(root, f->name, getField(e, f));
+			break;
+
+		case FT_FLAG:
+			if (*((int*)getField(e, f)))
+			{
+				cJSON_AddNumberToObject(root, f->name, 1);
+			}
+			break;
+
+		case FT_FACING:
+			cJSON_AddStringToObject(root, f->name, e->facing == 0 ? "left" : "right");
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* those of the stage's entities that a stage can place, returning how many there were */
+int serialiseEntities(Snapshot *s)
+{
+	Entity *e;
+	int n, type;
+
+	n = 0;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		type = getStagePrototypeIndex(e->def);
+
+		if (type != -1)
+		{
+			serialiseEntity(e, type, s);
+
+			n++;
+		}
+	}
+
+	return n;
+}
+
+static void serialiseEntity(Entity *e, int type, Snapshot *s)
+{
+	EntityField *f;
+	unsigned char byte;
+	float value;
+	int bits;
+
+	byte = type;
+	appendSnapshot(s, &byte, 1);
+	writeInt(s, e->x);
+	writeInt(s, e->y);
+	writeString(s, e->name);
+
+	for (f = e->def->fields ; f < e->def->fields + e->def->numFields ; f++)
+	{
+		switch (f->type)
+		{
+			case FT_INT:
+			case FT_FLAG:
+				writeInt(s, *((int*)getField(e, f)));
+				break;
+
+			case FT_FLOAT:
+				value = *((float*)getField(e, f));
+				memcpy(&bits, &value, sizeof(int));
+				writeInt(s, bits);
+				break;
+
+			case FT_STRING:
+				writeString(s, getField(e, f));
+				break;
+
+			case FT_FACING:
+				byte = e->facing;
+				appendSnapshot(s, &byte, 1);
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+/* adds numEnts entities, read from length bytes of records */
+void deserialiseEntities(char *data, int length, int numEnts)
+{
+	int i;
+
+	cursor = data;
+	end = data + length;
+
+	for (i = 0 ; i < numEnts ; i++)
+	{
+		loadStageEntity(deserialiseEntity());
+	}
+}
+
+static Entity *deserialiseEntity(void)
+{
+	char name[MAX_NAME_LENGTH];
+	EntityField *f;
+	Prototype *p;
+	Entity *e;
+	float value;
+	int x, y, bits;
+
+	p = getStagePrototype(readByte());
+
+	if (p == NULL)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Compiled entities have an unknown type");
+		exit(1);
+	}
+
+	x = readInt();
+	y = readInt();
+	readString(name);
+
+	e = createStageEntity(p, x, y, name);
+
+	for (f = e->def->fields ; f < e->def->fields + e->def->numFields ; f++)
+	{
+		switch (f->type)
+		{
+			case FT_INT:
+			case FT_FLAG:
+				*((int*)getField(e, f)) = readInt();
+				break;
+
+			case FT_FLOAT:
+				bits = readInt();
+				memcpy(&value, &bits, sizeof(float));
+				*((float*)getField(e, f)) = value;
+				break;
+
+			case FT_STRING:
+				readString(getField(e, f));
+				break;
+
+			case FT_FACING:
+				e->facing = readByte();
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return e;
+}
+
+static char *getField(Entity *e, EntityField *f)
+{
+	return (char*)e->data + f->offset;
+}
+
+static void writeInt(Snapshot *s, int value)
+{
+	value = SDL_SwapLE32(value);
+
+	appendSnapshot(s, &value, sizeof(int));
+}
+
+static void writeString(Snapshot *s, char *value)
+{
+	unsigned char n;
+
+	n = strlen(value);
+
+	appendSnapshot(s, &n, 1);
+	appendSnapshot(s, value, n);
+}
+
+static int readInt(void)
+{
+	int value;
+
+	if (end - cursor < (int)sizeof(int))
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Compiled entities are truncated");
+		exit(1);
+	}
+
+	memcpy(&value, cursor, sizeof(int));
+
+	cursor += sizeof(int);
+
+	return SDL_SwapLE32(value);
+}
+
+static int readByte(void)
+{
+	if (cursor >= end)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Compiled entities are truncated");
+		exit(1);
+	}
+
+	return *((unsigned char*)cursor++);
+}
+
+static void readString(char *dest)
+{
+	int n;
+
+	n = readByte();
+
+	if (n >= MAX_NAME_LENGTH || end - cursor < n)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Compiled entities are truncated");
+		exit(1);
+	}
+
+	memcpy(dest, cursor, n);
+	dest[n] = '\0';
+
+	cursor += n;
+}
+
+/* 0 if there's no compiled copy of the stage's entities, or it's out of date, so they must come from json */
+int loadCompiledEntities(const char *json)
+{
+	CompiledEntitiesHeader header;
+	char filename[MAX_FILENAME_LENGTH], *data;
+	const char *path;
+	int length;
+
+	getCompiledFilename(filename);
+
+	path = findFileLocation(filename);
+
+	if (path == NULL)
+	{
+		return 0;
+	}
+
+	data = readBinaryFile(path, &length);
+
+	if (data == NULL || length < (int)sizeof(CompiledEntitiesHeader))
+	{
+		free(data);
+
+		return 0;
+	}
+
+	memcpy(&header, data, sizeof(CompiledEntitiesHeader));
+
+	if (memcmp(header.magic, COMPILED_ENTITIES_MAGIC, 4) != 0 || SDL_SwapLE32(header.version) != COMPILED_ENTITIES_VERSION || SDL_SwapLE32(header.schema) != getSchema() || SDL_SwapLE32(header.source) != hashBytes(2166136261u, json, strlen(json)))
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_DEBUG, "'%s' is out of date", path);
+
+		free(data);
+
+		return 0;
+	}
+
+	deserialiseEntities(data + sizeof(CompiledEntitiesHeader), length - sizeof(CompiledEntitiesHeader), SDL_SwapLE32(header.numEnts));
+
+	free(data);
+
+	return 1;
+}
+
+/* written alongside the stage's json, which must be what it was loaded from */
+void compileEntities(const char *json)
+{
+	CompiledEntitiesHeader header;
+	char filename[MAX_FILENAME_LENGTH];
+	Snapshot s;
+
+	memset(&s, 0, sizeof(Snapshot));
+
+	appendSnapshot(&s, NULL, sizeof(CompiledEntitiesHeader));
+
+	memcpy(header.magic, COMPILED_ENTITIES_MAGIC, 4);
+	header.version = SDL_SwapLE32(COMPILED_ENTITIES_VERSION);
+	header.schema = SDL_SwapLE32(getSchema());
+	header.source = SDL_SwapLE32(hashBytes(2166136261u, json, strlen(json)));
+	header.numEnts = SDL_SwapLE32(serialiseEntities(&s));
+
+	memcpy(s.data, &header, sizeof(CompiledEntitiesHeader));
+
+	getCompiledFilename(filename);
+
+	if (!writeBinaryFile(filename, s.data, s.size))
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "Couldn't write '%s'", filename);
+	}
+
+	free(s.data);
+}
+
+/* for -compileStages, to write out every stage's entities */
+void compileStages(void)
+{
+	char **filenames, filename[MAX_FILENAME_LENGTH], *json;
+	int i, n;
+
+	/* loading each stage mustn't count as having started it, or save the game */
+	app.headless = 1;
+
+	filenames = getFileList("data/stages", &n);
+
+	for (i = 0 ; i < n ; i++)
+	{
+		if (strstr(filenames[i], ".json") != NULL)
+		{
+			initStage();
+
+			stage.num = atoi(filenames[i]);
+
+			loadStage(0);
+
+			sprintf(filename, "data/stages/%s", filenames[i]);
+
+			json = readFile(getFileLocation(filename));
+
+			compileEntities(json);
+
+			SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO, "Compiled %s", filename);
+
+			free(json);
+
+			destroyStage();
+		}
+
+		free(filenames[i]);
+	}
+
+	free(filenames);
+
+	exit(0);
+}
+
+/* changes whenever a type, or the fields a type has, do, so that older compiled stages are ignored */
+static unsigned int getSchema(void)
+{
+	static unsigned int schema;
+	EntityField *f;
+	Prototype *p;
+	int i;
+
+	if (schema == 0)
+	{
+		schema = 2166136261u;
+
+		for (i = 0 ; (p = getStagePrototype(i)) != NULL ; i++)
+		{
+			schema = hashBytes(schema, p->id, strlen(p->id) + 1);
+
+			for (f = p->entity.def->fields ; f < p->entity.def->fields + p->entity.def->numFields ; f++)
+			{
+				schema = hashBytes(schema, f->name, strlen(f->name) + 1);
+				schema = hashBytes(schema, &f->type, sizeof(int));
+			}
+		}
+	}
+
+	return schema;
+}
+
+static unsigned int hashBytes(unsigned int hash, const void *data, int n)
+{
+	const unsigned char *c;
+
+	for (c = data ; n > 0 ; c++, n--)
+	{
+		hash = (hash ^ *c) * 16777619u;
+	}
+
+	return hash;
+}
+
+static void getCompiledFilename(char *filename)
+{
+	sprintf(filename, "data/stages/%03d.wce", stage.num);
+}
@@ -23,12 +23,20 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../json/cJSON.h"
 #include "../system/atlas.h"
 #include "../system/draw.h"
+#include "../system/spriteBatch.h"
+#include "../world/tileLayers.h"
 
+extern App app;
 extern Stage stage;
 
+static void drawChunk(int cx, int cy);
+static void renderChunk(int cx, int cy);
 static void loadTiles(void);
 static void loadMap(cJSON *root);
 
+static SDL_Texture *chunks[MAP_CHUNKS_X][MAP_CHUNKS_Y];
+static int dirtyChunks[MAP_CHUNKS_X][MAP_CHUNKS_Y];
+
 void initMap(cJSON *root)
 {
 	memset(&stage.map, 0, sizeof(int) * MAP_WIDTH * MAP_HEIGHT);
@@ -36,41 +44,142 @@ void initMap(cJSON *root)
 	loadTiles();
 
 	loadMap(root);
+
+	invalidateChunks();
 }
 
+/*
+ * The tiles don't change during play, so rather than blitting each one every frame, the map is
+ * drawn in chunks of MAP_CHUNK_WIDTH x MAP_CHUNK_HEIGHT tiles, each rendered once into its own
+ * texture the first time it's seen after the stage loads or one of its tiles is set, and only
+ * the chunks on screen are drawn.
+ */
 void drawMap(void)
 {
-	int x, y, n, x1, x2, y1, y2, mx, my;
+	int cx, cy, cx1, cx2, cy1, cy2;
+
+	cx1 = MAX(stage.camera.x, 0) / (MAP_CHUNK_WIDTH * TILE_SIZE);
+	cx2 = MIN((stage.camera.x + SCREEN_WIDTH - 1) / (MAP_CHUNK_WIDTH * TILE_SIZE), MAP_CHUNKS_X - 1);
+
+	cy1 = MAX(stage.camera.y, 0) / (MAP_CHUNK_HEIGHT * TILE_SIZE);
+	cy2 = MIN((stage.camera.y + SCREEN_HEIGHT - 1) / (MAP_CHUNK_HEIGHT * TILE_SIZE), MAP_CHUNKS_Y - 1);
+
+	for (cy = cy1 ; cy <= cy2 ; cy++)
+	{
+		for (cx = cx1 ; cx <= cx2 ; cx++)
+		{
+			drawChunk(cx, cy);
+		}
+	}
+
+	drawTileLayers();
+}
+
+void setMapTile(int x, int y, int tile)
+{
+	if (isInsideMap(x, y))
+	{
+		stage.map[x][y] = tile;
+
+		dirtyChunks[x / MAP_CHUNK_WIDTH][y / MAP_CHUNK_HEIGHT] = 1;
+	}
+}
 
-	x1 = (stage.camera.x % TILE_SIZE) * -1;
-	x2 = x1 + MAP_RENDER_WIDTH * TILE_SIZE + (x1 == 0 ? 0 : TILE_SIZE);
+static void drawChunk(int cx, int cy)
+{
+	if (chunks[cx][cy] == NULL)
+	{
+		chunks[cx][cy] = SDL_CreateTexture(app.renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, MAP_CHUNK_WIDTH * TILE_SIZE, MAP_CHUNK_HEIGHT * TILE_SIZE);
 
-	y1 = (stage.camera.y % TILE_SIZE) * -1;
-	y2 = y1 + MAP_RENDER_HEIGHT * TILE_SIZE + (y1 == 0 ? 0 : TILE_SIZE);
+		SDL_SetTextureBlendMode(chunks[cx][cy], SDL_BLENDMODE_BLEND);
 
-	mx = stage.camera.x / TILE_SIZE;
-	my = stage.camera.y / TILE_SIZE;
+		dirtyChunks[cx][cy] = 1;
+	}
 
-	for (y = y1 ; y < y2 ; y += TILE_SIZE)
+	if (dirtyChunks[cx][cy])
 	{
-		for (x = x1 ; x < x2 ; x += TILE_SIZE)
+		renderChunk(cx, cy);
+
+		dirtyChunks[cx][cy] = 0;
+	}
+
+	blit(chunks[cx][cy], (cx * MAP_CHUNK_WIDTH * TILE_SIZE) - stage.camera.x, (cy * MAP_CHUNK_HEIGHT * TILE_SIZE) - stage.camera.y, 0, SDL_FLIP_NONE);
+}
+
+static void renderChunk(int cx, int cy)
+{
+	SDL_Texture *target, *texture;
+	SDL_BlendMode blendMode;
+	int x, y, mx, my, n;
+
+	/* anything already batched belongs to the scene, not the chunk */
+	flushSprites();
+
+	target = SDL_GetRenderTarget(app.renderer);
+
+	SDL_SetRenderTarget(app.renderer, chunks[cx][cy]);
+	SDL_SetRenderDrawColor(app.renderer, 0, 0, 0, 0);
+	SDL_RenderClear(app.renderer);
+
+	texture = NULL;
+	blendMode = SDL_BLENDMODE_BLEND;
+
+	for (y = 0 ; y < MAP_CHUNK_HEIGHT ; y++)
+	{
+		for (x = 0 ; x < MAP_CHUNK_WIDTH ; x++)
 		{
+			mx = (cx * MAP_CHUNK_WIDTH) + x;
+			my = (cy * MAP_CHUNK_HEIGHT) + y;
+
 			if (isInsideMap(mx, my))
 			{
 				n = stage.map[mx][my];
 
 				if (n > 0)
 				{
-					blitAtlasImage(stage.tiles[n], x, y, 0, SDL_FLIP_NONE);
+					/* copied as they are, and flushed before the blend mode goes back, so the chunk blends as the tiles would have */
+					if (stage.tiles[n]->texture != texture)
+					{
+						flushSprites();
+
+						if (texture != NULL)
+						{
+							SDL_SetTextureBlendMode(texture, blendMode);
+						}
+
+						texture = stage.tiles[n]->texture;
+
+						SDL_GetTextureBlendMode(texture, &blendMode);
+						SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+					}
+
+					blitAtlasImage(stage.tiles[n], x * TILE_SIZE, y * TILE_SIZE, 0, SDL_FLIP_NONE);
 				}
 			}
-
-			mx++;
 		}
+	}
 
-		mx = stage.camera.x / TILE_SIZE;
+	flushSprites();
 
-		my++;
+	if (texture != NULL)
+	{
+		SDL_SetTextureBlendMode(texture, blendMode);
+	}
+
+	SDL_SetRenderTarget(app.renderer, target);
+}
+
+/* for when the chunks' contents can't be trusted, such as after the renderer has lost its render targets */
+void invalidateChunks(void)
+{
+	int x, y;
+
+	for (x = 0 ; x < MAP_CHUNKS_X ; x++)
+	{
+		for (y = 0 ; y < MAP_CHUNKS_Y ; y++)
+		{
+			dirtyChunks[x][y] = 1;
+		}
 	}
 }
 
@@ -142,6 +251,8 @@ void randomizeTiles(void)
 			}
 		}
 	}
+
+	invalidateChunks();
 }
 
 int isInsideMap(int x, int y)
@@ -149,3 +260,20 @@ int isInsideMap(int x, int y)
 	return x >= 0 && y >= 0 && x < MAP_WIDTH && y < MAP_HEIGHT;
 }
 
+void destroyMap(void)
+{
+	int x, y;
+
+	for (x = 0 ; x < MAP_CHUNKS_X ; x++)
+	{
+		for (y = 0 ; y < MAP_CHUNKS_Y ; y++)
+		{
+			if (chunks[x][y] != NULL)
+			{
+				SDL_DestroyTexture(chunks[x][y]);
+
+				chunks[x][y] = NULL;
+			}
+		}
+	}
+}
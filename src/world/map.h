@@ -18,7 +18,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+void destroyMap(void);
 int isInsideMap(int x, int y);
+void setMapTile(int x, int y, int tile);
 void randomizeTiles(void);
+void invalidateChunks(void);
 void drawMap(void);
 void initMap(cJSON *root);
@@ -22,9 +22,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "particles.h"
 #include "../system/atlas.h"
 #include "../system/draw.h"
+#include "../world/commandBuffer.h"
 
 extern Stage stage;
 
+static int isSkipped(void (*add)(int x, int y), int x, int y);
 static Particle *spawnParticle(void);
 
 static AtlasImage *basicTexture;
@@ -69,16 +71,15 @@ void doParticles(void)
 void drawParticles(void)
 {
 	Particle *p;
+	SDL_Color c;
 
 	for (p = stage.particleHead.next ; p != NULL ; p = p->next)
 	{
-		SDL_SetTextureColorMod(p->atlasImage->texture, p->color.r, p->color.g, p->color.b);
+		c = p->color;
+		c.a = 255;
 
-		blitAtlasImage(p->atlasImage, p->x - stage.camera.x, p->y - stage.camera.y, 1, SDL_FLIP_NONE);
+		blitTintedAtlasImage(p->atlasImage, p->x - stage.camera.x, p->y - stage.camera.y, 1, SDL_FLIP_NONE, c);
 	}
-
-	/* restore colour */
-	SDL_SetTextureColorMod(basicTexture->texture, 255, 255, 255);
 }
 
 void addCoinParticles(int x, int y)
@@ -86,6 +87,11 @@ void addCoinParticles(int x, int y)
 	Particle *p;
 	int i;
 
+	if (isSkipped(addCoinParticles, x, y))
+	{
+		return;
+	}
+
 	for (i = 0 ; i < 12 ; i++)
 	{
 		p = spawnParticle();
@@ -115,6 +121,11 @@ void addPowerupParticles(int x, int y)
 	Particle *p;
 	int i;
 
+	if (isSkipped(addPowerupParticles, x, y))
+	{
+		return;
+	}
+
 	for (i = 0 ; i < 25 ; i++)
 	{
 		p = spawnParticle();
@@ -144,6 +155,11 @@ void addToiletSplashParticles(int x, int y)
 	Particle *p;
 	int i;
 
+	if (isSkipped(addToiletSplashParticles, x, y))
+	{
+		return;
+	}
+
 	for (i = 0 ; i < 20 ; i++)
 	{
 		p = spawnParticle();
@@ -171,6 +187,11 @@ void addDeathParticles(int x, int y)
 	Particle *p;
 	int i;
 
+	if (isSkipped(addDeathParticles, x, y))
+	{
+		return;
+	}
+
 	for (i = 0 ; i < 100 ; i++)
 	{
 		p = spawnParticle();
@@ -198,6 +219,11 @@ void addWaterBurstParticles(int x, int y)
 	Particle *p;
 	int i;
 
+	if (isSkipped(addWaterBurstParticles, x, y))
+	{
+		return;
+	}
+
 	for (i = 0 ; i < 12 ; i++)
 	{
 		p = spawnParticle();
@@ -225,6 +251,11 @@ void addSlimeBurstParticles(int x, int y)
 	Particle *p;
 	int i;
 
+	if (isSkipped(addSlimeBurstParticles, x, y))
+	{
+		return;
+	}
+
 	for (i = 0 ; i < 12 ; i++)
 	{
 		p = spawnParticle();
@@ -247,6 +278,25 @@ void addSlimeBurstParticles(int x, int y)
 	}
 }
 
+/* fast-forward's in-between ticks are never drawn, so their particles would only be
+ * aged away unseen. Particles are the only thing that draws on rand() mid-stage, so
+ * leaving them out doesn't change how the stage plays out */
+static int isSkipped(void (*add)(int x, int y), int x, int y)
+{
+	if (stage.skipEffects)
+	{
+		return 1;
+	}
+
+	if (isDeferring())
+	{
+		deferParticles(add, x, y);
+		return 1;
+	}
+
+	return 0;
+}
+
 static Particle *spawnParticle(void)
 {
 	Particle *p;
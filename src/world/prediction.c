@@ -0,0 +1,240 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "prediction.h"
+#include "../system/atlas.h"
+#include "../system/controls.h"
+#include "../system/draw.h"
+#include "../world/entities.h"
+#include "../world/rewind.h"
+#include "../world/snapshot.h"
+
+extern App app;
+extern Game game;
+extern Stage stage;
+
+static void lookAhead(Uint64 budget);
+static void addPoints(void);
+static void addPoint(Entity *e);
+static int getHeldControls(void);
+
+static PredictionTrail trails[MAX_PREDICTION_TRAILS];
+static int numTrails;
+static Snapshot fork;
+static int enabled;
+static int timer;
+static AtlasImage *dotTexture;
+
+void initPrediction(void)
+{
+	dotTexture = getAtlasImage("gfx/particles/basic.png", 1);
+}
+
+void togglePrediction(void)
+{
+	enabled = !enabled;
+
+	timer = 0;
+
+	clearPrediction();
+}
+
+/*
+ * Every PREDICTION_INTERVAL frames the stage is saved as it is, played on for up to
+ * PREDICTION_FRAMES with the player still holding whatever they are holding now, and then
+ * put back. Where the player and the clones got to along the way is kept to be drawn. If
+ * PREDICTION_BUDGET runs out first, the trails are just shorter.
+ */
+void doPrediction(void)
+{
+	Uint64 then;
+	unsigned int stats[STAT_MAX];
+	int playing, controls;
+
+	if (!enabled || stage.status != SS_INCOMPLETE || --timer > 0)
+	{
+		return;
+	}
+
+	timer = PREDICTION_INTERVAL;
+
+	then = SDL_GetPerformanceCounter();
+
+	captureStage(&fork);
+
+	memcpy(stats, game.stats, sizeof(stats));
+
+	/* held controls are handed over the same way a replay's are */
+	playing = app.replay.playing;
+	controls = app.replay.controls;
+
+	app.replay.controls = getHeldControls();
+	app.replay.playing = 1;
+
+	stage.skipEffects = stage.predicting = 1;
+
+	lookAhead(then + SDL_GetPerformanceFrequency() * PREDICTION_BUDGET / 1000);
+
+	stage.skipEffects = stage.predicting = 0;
+
+	app.replay.playing = playing;
+	app.replay.controls = controls;
+
+	memcpy(game.stats, stats, sizeof(stats));
+
+	restoreStage(&fork);
+
+	app.dev.predictionCost = (SDL_GetPerformanceCounter() - then) * 1000000 / SDL_GetPerformanceFrequency();
+}
+
+static void lookAhead(Uint64 budget)
+{
+	int i;
+
+	numTrails = 0;
+
+	addPoints();
+
+	for (i = 1 ; i <= PREDICTION_FRAMES && stage.status == SS_INCOMPLETE && SDL_GetPerformanceCounter() < budget ; i++)
+	{
+		doEntities();
+
+		stage.frame++;
+
+		if (i % PREDICTION_STEP == 0)
+		{
+			addPoints();
+		}
+	}
+
+	app.dev.predictionFrames = i - 1;
+}
+
+static void addPoints(void)
+{
+	Entity *e;
+
+	for (e = stage.typeHead[ET_PLAYER] ; e != NULL ; e = e->typeNext)
+	{
+		addPoint(e);
+	}
+
+	for (e = stage.typeHead[ET_CLONE] ; e != NULL ; e = e->typeNext)
+	{
+		addPoint(e);
+	}
+}
+
+static void addPoint(Entity *e)
+{
+	PredictionTrail *t;
+	int i;
+
+	t = NULL;
+
+	for (i = 0 ; i < numTrails ; i++)
+	{
+		if (trails[i].id == e->id)
+		{
+			t = &trails[i];
+		}
+	}
+
+	if (t == NULL)
+	{
+		if (numTrails == MAX_PREDICTION_TRAILS)
+		{
+			return;
+		}
+
+		t = &trails[numTrails++];
+		t->id = e->id;
+		t->type = e->def->type;
+		t->numPoints = 0;
+	}
+
+	if (t->numPoints < PREDICTION_FRAMES / PREDICTION_STEP + 1)
+	{
+		t->points[t->numPoints].x = e->x + e->w / 2;
+		t->points[t->numPoints].y = e->y + e->h / 2;
+		t->numPoints++;
+	}
+}
+
+/* only the ones that carry on from frame to frame; using something is left to the player */
+static int getHeldControls(void)
+{
+	int controls;
+
+	controls = 0;
+
+	if (isControl(CONTROL_LEFT))
+	{
+		controls |= 1 << CONTROL_LEFT;
+	}
+
+	if (isControl(CONTROL_RIGHT))
+	{
+		controls |= 1 << CONTROL_RIGHT;
+	}
+
+	if (isControl(CONTROL_JUMP))
+	{
+		controls |= 1 << CONTROL_JUMP;
+	}
+
+	return controls;
+}
+
+/* a dot every other point, fading out towards the end of the look-ahead */
+void drawPrediction(void)
+{
+	PredictionTrail *t;
+	SDL_Color c;
+	int i, j;
+
+	for (i = 0 ; i < numTrails ; i++)
+	{
+		t = &trails[i];
+
+		c = t->type == ET_PLAYER ? app.colors.white : app.colors.cyan;
+
+		for (j = 1 ; j < t->numPoints ; j += 2)
+		{
+			c.a = 255 - (j * 192 / t->numPoints);
+
+			/* from the atlas, so that a trail is batched with the sprites rather than flushing them for every dot */
+			blitTintedAtlasImage(dotTexture, t->points[j].x - stage.camera.x, t->points[j].y - stage.camera.y, 1, SDL_FLIP_NONE, c);
+		}
+	}
+}
+
+void clearPrediction(void)
+{
+	numTrails = 0;
+
+	app.dev.predictionFrames = app.dev.predictionCost = 0;
+}
+
+void destroyPrediction(void)
+{
+	destroySnapshot(&fork);
+}
@@ -0,0 +1,614 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "projectiles.h"
+#include "../system/atlas.h"
+#include "../system/draw.h"
+#include "../system/sound.h"
+#include "../system/util.h"
+#include "../world/commandBuffer.h"
+#include "../world/entityPool.h"
+#include "../world/map.h"
+#include "../world/particles.h"
+
+#define INITIAL_HIT_CAPACITY    64
+
+/* what a projectile can hit */
+enum
+{
+	TM_SOLID = 1,
+	TM_WALTER = 2,
+	TM_HIT = 4
+};
+
+extern App app;
+extern _Thread_local Entity *self;
+extern Stage stage;
+
+static void formSlime(void);
+static void integrate(void);
+static void gatherTargets(void);
+static void hitTargets(void);
+static void hitProjectiles(void);
+static void hitWorld(void);
+static void deliverHits(void);
+static void burst(int i);
+static void addHit(int i, Entity *target);
+static void removeDead(void);
+static int getTargetMask(Entity *e);
+
+static ProjectileDef defs[PT_MAX];
+static AtlasImage *sparkleTexture;
+static Entity **targets;
+static int *targetMasks;
+static int numTargets;
+static int targetCapacity;
+static ProjectileHit *hits;
+static int numHits;
+static int hitCapacity;
+
+void initProjectiles(void)
+{
+	defs[PT_WATER].atlasImage = getAtlasImage("gfx/entities/waterBullet.png", 1);
+	defs[PT_WATER].speed = 12;
+	defs[PT_WATER].targets = TM_SOLID|TM_HIT;
+
+	defs[PT_SPIT].atlasImage = getAtlasImage("gfx/entities/spitterBullet.png", 1);
+	defs[PT_SPIT].speed = 8;
+	defs[PT_SPIT].targets = TM_SOLID|TM_WALTER|TM_HIT;
+	defs[PT_SPIT].light.g = 255;
+	defs[PT_SPIT].light.a = 48;
+
+	defs[PT_SLIME].atlasImage = getAtlasImage("gfx/entities/drip.png", 1);
+	defs[PT_SLIME].background = 1;
+	defs[PT_SLIME].targets = TM_SOLID|TM_WALTER|TM_HIT;
+	defs[PT_SLIME].light.g = 255;
+	defs[PT_SLIME].light.a = 48;
+
+	sparkleTexture = getAtlasImage("gfx/particles/light.png", 1);
+}
+
+/* places the projectile as the owner fires it */
+void fireProjectile(int type, Entity *owner)
+{
+	AtlasImage *img;
+	float x, y;
+
+	img = defs[type].atlasImage;
+
+	x = owner->x;
+	y = owner->y;
+
+	switch (type)
+	{
+		case PT_WATER:
+			y += img->rect.h / 2;
+			break;
+
+		case PT_SPIT:
+			/* center horizontally */
+			y += (owner->w / 2) - (img->rect.h / 2);
+			break;
+
+		default:
+			y -= owner->h * 2;
+			break;
+	}
+
+	if (type != PT_SLIME && owner->facing)
+	{
+		x += owner->w;
+	}
+
+	addProjectile(type, x, y, owner->facing);
+}
+
+void addProjectile(int type, float x, float y, int facing)
+{
+	Projectiles *p;
+	int i;
+
+	if (isDeferring())
+	{
+		deferProjectile(type, x, y, facing);
+		return;
+	}
+
+	p = &stage.projectiles;
+
+	/* rather than stop the game, a full pool just loses the shot */
+	if (p->count == MAX_PROJECTILES)
+	{
+		return;
+	}
+
+	i = p->count++;
+
+	p->x[i] = x;
+	p->y[i] = y;
+	p->dx[i] = facing ? defs[type].speed : -defs[type].speed;
+	p->dy[i] = 0;
+	p->gravity[i] = 0;
+	p->type[i] = type;
+	p->facing[i] = facing;
+	p->timer[i] = 0;
+	p->alive[i] = 1;
+
+	/* slime hangs from its drip for a second before it falls */
+	if (type == PT_SLIME)
+	{
+		p->dy[i] = 0.5f;
+		p->timer[i] = FPS - 1;
+	}
+}
+
+/*
+ * Projectiles are not entities: they are moved in one loop, and then tested against the
+ * entities that they can hit, each other and the map, in batches. What they hit is
+ * gathered and then delivered in the order they were fired.
+ */
+void doProjectiles(void)
+{
+	if (stage.projectiles.count == 0)
+	{
+		return;
+	}
+
+	formSlime();
+
+	integrate();
+
+	gatherTargets();
+
+	numHits = 0;
+
+	hitTargets();
+
+	hitProjectiles();
+
+	hitWorld();
+
+	deliverHits();
+
+	removeDead();
+}
+
+static void formSlime(void)
+{
+	Projectiles *p;
+	int i;
+
+	p = &stage.projectiles;
+
+	for (i = 0 ; i < p->count ; i++)
+	{
+		if (p->timer[i] > 0 && --p->timer[i] == 0)
+		{
+			p->gravity[i] = 1.5f;
+
+			playPositionalSound(SND_DRIP, CH_SPIT, p->x[i], p->y[i], getPlayer()->x, getPlayer()->y);
+		}
+	}
+}
+
+static void integrate(void)
+{
+	Projectiles *p;
+	float *x, *y, *dx, *dy, *gravity;
+	int i, n;
+
+	p = &stage.projectiles;
+
+	n = p->count;
+	x = p->x;
+	y = p->y;
+	dx = p->dx;
+	dy = p->dy;
+	gravity = p->gravity;
+
+	for (i = 0 ; i < n ; i++)
+	{
+		dy[i] = MIN(dy[i] + gravity[i], 18);
+
+		x[i] += dx[i];
+		y[i] += dy[i];
+	}
+}
+
+/* only a handful of entities can be hit, so they are collected once rather than looked up for every projectile */
+static void gatherTargets(void)
+{
+	Entity *e;
+	int mask, n;
+
+	numTargets = 0;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		mask = getTargetMask(e);
+
+		if (mask != 0)
+		{
+			if (numTargets == targetCapacity)
+			{
+				n = MAX(targetCapacity * 2, 32);
+
+				targets = resize(targets, sizeof(Entity*) * targetCapacity, sizeof(Entity*) * n);
+				targetMasks = resize(targetMasks, sizeof(int) * targetCapacity, sizeof(int) * n);
+				targetCapacity = n;
+			}
+
+			targets[numTargets] = e;
+			targetMasks[numTargets] = mask;
+
+			numTargets++;
+		}
+	}
+}
+
+static int getTargetMask(Entity *e)
+{
+	int mask;
+
+	mask = 0;
+
+	if (e->flags & EF_SOLID)
+	{
+		mask |= TM_SOLID;
+	}
+
+	if (isWalter(e))
+	{
+		mask |= TM_WALTER;
+	}
+
+	if (e->def->hit)
+	{
+		mask |= TM_HIT;
+	}
+
+	return mask;
+}
+
+static void hitTargets(void)
+{
+	Projectiles *p;
+	Entity *e;
+	AtlasImage *img;
+	int i, j, w, h;
+
+	p = &stage.projectiles;
+
+	for (i = 0 ; i < p->count ; i++)
+	{
+		/* still hanging from the drip */
+		if (p->timer[i] > 0)
+		{
+			continue;
+		}
+
+		img = defs[p->type[i]].atlasImage;
+		w = img->rect.w;
+		h = img->rect.h;
+
+		for (j = 0 ; j < numTargets ; j++)
+		{
+			e = targets[j];
+
+			if ((targetMasks[j] & defs[p->type[i]].targets) && collision(p->x[i], p->y[i], w, h, e->x, e->y, e->w, e->h))
+			{
+				if (p->alive[i] && e->flags & EF_SOLID)
+				{
+					if (p->dx[i] != 0)
+					{
+						p->x[i] = p->dx[i] > 0 ? e->x - w : e->x + e->w;
+					}
+					else
+					{
+						p->y[i] = p->dy[i] > 0 ? e->y - h : e->y + e->h;
+					}
+				}
+
+				p->alive[i] = 0;
+
+				addHit(i, e);
+			}
+		}
+	}
+}
+
+/* water puts out spit and slime, even while it is still forming */
+static void hitProjectiles(void)
+{
+	Projectiles *p;
+	AtlasImage *img, *otherImg;
+	int i, j;
+
+	p = &stage.projectiles;
+
+	for (i = 0 ; i < p->count ; i++)
+	{
+		if (p->type[i] == PT_WATER && p->alive[i])
+		{
+			img = defs[PT_WATER].atlasImage;
+
+			for (j = 0 ; j < p->count ; j++)
+			{
+				if (p->type[j] != PT_WATER && p->alive[j])
+				{
+					otherImg = defs[p->type[j]].atlasImage;
+
+					if (collision(p->x[i], p->y[i], img->rect.w, img->rect.h, p->x[j], p->y[j], otherImg->rect.w, otherImg->rect.h))
+					{
+						p->alive[i] = p->alive[j] = 0;
+
+						addHit(i, NULL);
+						addHit(j, NULL);
+
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+static void hitWorld(void)
+{
+	Projectiles *p;
+	AtlasImage *img;
+	int i, mx, my, hit;
+
+	p = &stage.projectiles;
+
+	for (i = 0 ; i < p->count ; i++)
+	{
+		if (!p->alive[i] || p->timer[i] > 0)
+		{
+			continue;
+		}
+
+		img = defs[p->type[i]].atlasImage;
+
+		hit = 0;
+
+		if (p->dx[i] != 0)
+		{
+			mx = p->dx[i] > 0 ? (p->x[i] + img->rect.w) : p->x[i];
+			mx /= TILE_SIZE;
+
+			my = p->y[i] / TILE_SIZE;
+
+			hit = !isInsideMap(mx, my) || stage.map[mx][my] != 0;
+
+			my = (p->y[i] + img->rect.h - 1) / TILE_SIZE;
+
+			hit |= !isInsideMap(mx, my) || stage.map[mx][my] != 0;
+
+			if (hit)
+			{
+				p->x[i] = (mx * TILE_SIZE) + (p->dx[i] > 0 ? -img->rect.w : TILE_SIZE);
+			}
+		}
+		else
+		{
+			my = p->dy[i] > 0 ? (p->y[i] + img->rect.h) : p->y[i];
+			my /= TILE_SIZE;
+
+			mx = p->x[i] / TILE_SIZE;
+
+			hit = !isInsideMap(mx, my) || stage.map[mx][my] != 0;
+
+			mx = (p->x[i] + img->rect.w - 1) / TILE_SIZE;
+
+			hit |= !isInsideMap(mx, my) || stage.map[mx][my] != 0;
+
+			if (hit)
+			{
+				p->y[i] = (my * TILE_SIZE) + (p->dy[i] > 0 ? -img->rect.h : TILE_SIZE);
+			}
+		}
+
+		if (hit)
+		{
+			p->alive[i] = 0;
+
+			addHit(i, NULL);
+		}
+	}
+}
+
+static void addHit(int i, Entity *target)
+{
+	int n;
+
+	if (numHits == hitCapacity)
+	{
+		n = MAX(hitCapacity * 2, INITIAL_HIT_CAPACITY);
+
+		hits = resize(hits, sizeof(ProjectileHit) * hitCapacity, sizeof(ProjectileHit) * n);
+		hitCapacity = n;
+	}
+
+	hits[numHits].projectile = i;
+	hits[numHits].target = target;
+
+	numHits++;
+}
+
+static void deliverHits(void)
+{
+	Projectiles *p;
+	ProjectileHit *h;
+	Entity *e, *oldSelf;
+	Walter *w;
+	int i, type;
+
+	p = &stage.projectiles;
+
+	oldSelf = self;
+
+	for (i = 0 ; i < numHits ; i++)
+	{
+		h = &hits[i];
+		e = h->target;
+		type = p->type[h->projectile];
+
+		if (e != NULL && type != PT_WATER && isWalter(e))
+		{
+			w = (Walter*)e->data;
+
+			/* a manhole cover only stops spit from the front */
+			if (type == PT_SLIME || p->facing[h->projectile] == e->facing || w->equipment != EQ_MANHOLE_COVER)
+			{
+				e->health = 0;
+			}
+		}
+
+		if (e != NULL && e->def->hit)
+		{
+			self = e;
+
+			e->def->hit(type);
+		}
+	}
+
+	self = oldSelf;
+
+	for (i = 0 ; i < p->count ; i++)
+	{
+		if (!p->alive[i])
+		{
+			burst(i);
+		}
+	}
+}
+
+static void burst(int i)
+{
+	Projectiles *p;
+
+	p = &stage.projectiles;
+
+	playPositionalSound(SND_SPIT_HIT, CH_HIT, p->x[i], p->y[i], getPlayer()->x, getPlayer()->y);
+
+	switch (p->type[i])
+	{
+		case PT_WATER:
+			addWaterBurstParticles(p->x[i], p->y[i]);
+			break;
+
+		case PT_SPIT:
+			addSlimeBurstParticles(p->x[i], p->y[i]);
+			break;
+
+		default:
+			addSlimeBurstParticles(p->x[i], p->y[i] + defs[PT_SLIME].atlasImage->rect.h / 2);
+			break;
+	}
+}
+
+/* keeps the survivors in the order they were fired */
+static void removeDead(void)
+{
+	Projectiles *p;
+	int i, n;
+
+	p = &stage.projectiles;
+
+	n = 0;
+
+	for (i = 0 ; i < p->count ; i++)
+	{
+		if (p->alive[i])
+		{
+			if (n != i)
+			{
+				p->x[n] = p->x[i];
+				p->y[n] = p->y[i];
+				p->dx[n] = p->dx[i];
+				p->dy[n] = p->dy[i];
+				p->gravity[n] = p->gravity[i];
+				p->type[n] = p->type[i];
+				p->facing[n] = p->facing[i];
+				p->timer[n] = p->timer[i];
+				p->alive[n] = 1;
+			}
+
+			n++;
+		}
+	}
+
+	p->count = n;
+}
+
+void drawProjectiles(int background)
+{
+	Projectiles *p;
+	ProjectileDef *def;
+	SDL_Color c;
+	int i, x, y;
+
+	p = &stage.projectiles;
+
+	for (i = 0 ; i < p->count ; i++)
+	{
+		def = &defs[p->type[i]];
+
+		x = p->x[i] - stage.camera.x;
+		y = p->y[i] - stage.camera.y;
+
+		if (def->background == background && collision(x, y, def->atlasImage->rect.w, def->atlasImage->rect.h, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT))
+		{
+			app.dev.drawing++;
+
+			if (def->light.a > 0)
+			{
+				c.r = def->light.r;
+				c.g = def->light.g;
+				c.b = def->light.b;
+				c.a = def->light.a;
+
+				blitTintedAtlasImage(sparkleTexture, x + def->atlasImage->rect.w / 2, y + def->atlasImage->rect.h / 2, 1, SDL_FLIP_NONE, c);
+			}
+
+			blitAtlasImage(def->atlasImage, x, y, 0, p->facing[i] == FACING_LEFT ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+		}
+	}
+}
+
+void clearProjectiles(void)
+{
+	stage.projectiles.count = 0;
+}
+
+void destroyProjectiles(void)
+{
+	free(targets);
+	free(targetMasks);
+	free(hits);
+
+	targets = NULL;
+	targetMasks = NULL;
+	hits = NULL;
+
+	targetCapacity = hitCapacity = numTargets = numHits = 0;
+}
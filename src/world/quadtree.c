@@ -32,6 +32,7 @@ static void removeEntity(Entity *e, Quadtree *root);
 static int entityComparator(const void *a, const void *b);
 static void getAllEntsWithinNode(int x, int y, int w, int h, Entity **candidates, Entity *ignore, Quadtree *root);
 static void destroyQuadtreeNode(Quadtree *root);
+static void forEachInQuadtreeNode(Quadtree *root, void (*fn)(Entity *e));
 static void resizeQTEntCapacity(Quadtree *root);
 
 static int cIndex;
@@ -258,7 +259,8 @@ static void getAllEntsWithinNode(int x, int y, int w, int h, Entity **candidates
 {
 	int index, i;
 
-	if (root->addedTo)
+	/* a node the area misses can't hold anything in it, as an entity only goes into a node that holds all of it */
+	if (root->addedTo && collision(x, y, w, h, root->x - 1, root->y - 1, root->w + 2, root->h + 2))
 	{
 		if (root->node[0])
 		{
@@ -295,6 +297,33 @@ static void getAllEntsWithinNode(int x, int y, int w, int h, Entity **candidates
 	}
 }
 
+/* visits each node's entities in the order the node holds them, so adding them back in this order rebuilds the same tree */
+void forEachInQuadtree(void (*fn)(Entity *e))
+{
+	forEachInQuadtreeNode(&stage.quadtree, fn);
+}
+
+static void forEachInQuadtreeNode(Quadtree *root, void (*fn)(Entity *e))
+{
+	int i;
+
+	if (root->addedTo)
+	{
+		if (root->node[0])
+		{
+			for (i = 0 ; i < 4 ; i++)
+			{
+				forEachInQuadtreeNode(root->node[i], fn);
+			}
+		}
+
+		for (i = 0 ; i < root->numEnts ; i++)
+		{
+			fn(root->ents[i]);
+		}
+	}
+}
+
 void destroyQuadtree(void)
 {
 	destroyQuadtreeNode(&stage.quadtree);
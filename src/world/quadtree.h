@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 void destroyQuadtree(void);
+void forEachInQuadtree(void (*fn)(Entity *e));
 Entity **getAllEntsWithin(int x, int y, int w, int h, Entity **candidates, Entity *ignore);
 void removeFromQuadtree(Entity *e, Quadtree *root);
 void addToQuadtree(Entity *e, Quadtree *root);
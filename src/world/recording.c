@@ -0,0 +1,238 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+#include "../common.h"
+#include "recording.h"
+#include "../system/util.h"
+
+extern Stage stage;
+
+static CloneRun *getRun(Recording *r, int i);
+static float getRunDY(CloneRun *run, int i);
+static CloneRun *addRun(Recording *r);
+static void clearRecording(Recording *r);
+
+static Recording recordingHead, *recordingTail = &recordingHead;
+
+/*
+ * What the player does is recorded so that their clones can repeat it. Only the frames where
+ * something was done are kept, and those are packed into runs: walking is the same dx for
+ * many frames, and a jump or a fall is the same dy plus the same gravity each frame. Every
+ * RECORDING_BLOCK_FRAMES frames, the first run that reaches that far is noted, so that any
+ * frame can be found by looking at no more than a block's worth of runs.
+ */
+void startRecording(void)
+{
+	Recording *r;
+
+	/* one that has been given to a clone is left alone, and a new one started */
+	if (stage.recording != NULL && stage.recording->users == 0)
+	{
+		clearRecording(stage.recording);
+
+		return;
+	}
+
+	r = malloc(sizeof(Recording));
+	memset(r, 0, sizeof(Recording));
+	recordingTail->next = r;
+	recordingTail = r;
+
+	stage.recording = r;
+}
+
+void recordFrame(int frame, float dx, float dy, int action)
+{
+	Recording *r;
+	CloneRun *run;
+
+	r = stage.recording;
+
+	run = r->numRuns > 0 ? getRun(r, r->numRuns - 1) : NULL;
+
+	if (run != NULL && frame == run->frame + run->length && dx == run->dx && action == run->action)
+	{
+		/* the second frame of a run decides the step */
+		if (run->length == 1)
+		{
+			run->ddy = dy - run->dy;
+		}
+
+		/* only if it plays back exactly as it was recorded */
+		if (getRunDY(run, run->length) != dy)
+		{
+			run = NULL;
+		}
+	}
+	else
+	{
+		run = NULL;
+	}
+
+	if (run != NULL)
+	{
+		run->length++;
+	}
+	else
+	{
+		run = addRun(r);
+
+		run->frame = frame;
+		run->length = 1;
+		run->dx = dx;
+		run->dy = dy;
+		run->ddy = 0;
+		run->action = action;
+	}
+
+	while (r->numBlocks <= frame / RECORDING_BLOCK_FRAMES)
+	{
+		if (r->numBlocks == r->blockCapacity)
+		{
+			r->blocks = resize(r->blocks, sizeof(int) * r->blockCapacity, sizeof(int) * MAX(r->blockCapacity * 2, 16));
+
+			r->blockCapacity = MAX(r->blockCapacity * 2, 16);
+		}
+
+		r->blocks[r->numBlocks++] = r->numRuns - 1;
+	}
+}
+
+/* forgets everything recorded from the frame onwards, when the stage is rewound to it */
+void rewindRecording(int frame)
+{
+	Recording *r;
+	CloneRun *run;
+
+	r = stage.recording;
+
+	while (r->numRuns > 0)
+	{
+		run = getRun(r, r->numRuns - 1);
+
+		if (run->frame < frame)
+		{
+			run->length = MIN(run->length, frame - run->frame);
+
+			/* every block up to the last frame still recorded is still found by the same run */
+			r->numBlocks = MIN(r->numBlocks, (run->frame + run->length - 1) / RECORDING_BLOCK_FRAMES + 1);
+
+			return;
+		}
+
+		r->numRuns--;
+	}
+
+	r->numBlocks = 0;
+}
+
+/* whether anything was done on the frame, and what it was */
+int getRecordedFrame(Recording *r, int frame, RecordedFrame *out)
+{
+	CloneRun *run;
+	int i, b;
+
+	b = frame / RECORDING_BLOCK_FRAMES;
+
+	if (r == NULL || frame < 0 || b >= r->numBlocks)
+	{
+		return 0;
+	}
+
+	for (i = r->blocks[b] ; i < r->numRuns ; i++)
+	{
+		run = getRun(r, i);
+
+		if (run->frame > frame)
+		{
+			return 0;
+		}
+
+		if (frame < run->frame + run->length)
+		{
+			if (out != NULL)
+			{
+				out->dx = run->dx;
+				out->dy = getRunDY(run, frame - run->frame);
+				out->action = run->action;
+			}
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static CloneRun *getRun(Recording *r, int i)
+{
+	return &r->chunks[i / RECORDING_CHUNK_RUNS][i % RECORDING_CHUNK_RUNS];
+}
+
+static float getRunDY(CloneRun *run, int i)
+{
+	return run->dy + (run->ddy * i);
+}
+
+static CloneRun *addRun(Recording *r)
+{
+	if (r->numRuns == r->numChunks * RECORDING_CHUNK_RUNS)
+	{
+		r->chunks = resize(r->chunks, sizeof(CloneRun*) * r->numChunks, sizeof(CloneRun*) * (r->numChunks + 1));
+
+		r->chunks[r->numChunks++] = malloc(sizeof(CloneRun) * RECORDING_CHUNK_RUNS);
+	}
+
+	return getRun(r, r->numRuns++);
+}
+
+/* keeps the chunks, to be written over */
+static void clearRecording(Recording *r)
+{
+	r->numRuns = 0;
+	r->numBlocks = 0;
+}
+
+void destroyRecordings(void)
+{
+	Recording *r;
+	int i;
+
+	while (recordingHead.next != NULL)
+	{
+		r = recordingHead.next;
+
+		recordingHead.next = r->next;
+
+		for (i = 0 ; i < r->numChunks ; i++)
+		{
+			free(r->chunks[i]);
+		}
+
+		free(r->chunks);
+
+		free(r->blocks);
+
+		free(r);
+	}
+
+	recordingTail = &recordingHead;
+
+	stage.recording = NULL;
+}
@@ -0,0 +1,489 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+#include "../common.h"
+#include "rewind.h"
+#include "../world/entities.h"
+#include "../world/recording.h"
+#include "../world/snapshot.h"
+
+/* a run of unchanged words shorter than a span's header is cheaper to copy along with the rest */
+#define SPAN_GAP    (sizeof(RewindSpan) / sizeof(int))
+
+extern App app;
+extern Game game;
+extern Stage stage;
+
+static void encodeDelta(void);
+static void makeRoom(int size);
+static int findSpace(int size);
+static void store(Snapshot *s, int keyframe);
+static void dropOldest(void);
+static RewindFrame *getFrame(int n);
+static void decodeFrame(int n);
+static void *getProjectileArray(int i);
+static int getNumProjectileArrays(void);
+static RewindState *getState(Snapshot *s);
+static void updateRewindStats(Uint64 then);
+
+static char *data;
+static RewindFrame frames[REWIND_FRAMES];
+static int first;
+static int count;
+static int tail;
+static int sinceKeyframe;
+static Snapshot current;
+static Snapshot previous;
+static Snapshot delta;
+
+void initRewind(void)
+{
+	data = malloc(REWIND_BUFFER_SIZE);
+}
+
+/*
+ * Every frame of the stage is kept, as far back as REWIND_FRAMES or REWIND_BUFFER_SIZE allow.
+ * Every REWIND_KEYFRAME_INTERVAL frames (or whenever an entity comes or goes) the whole frame
+ * is kept, and in between only the words that changed since the frame before. Projectiles come
+ * after the entities, so one being fired or removed only changes the words from there on, and
+ * doesn't need a keyframe. They're kept in a ring, so the oldest are written over, a keyframe
+ * and the frames that follow it at a time.
+ */
+void recordRewind(void)
+{
+	Snapshot swap;
+	Uint64 then;
+	int keyframe;
+
+	then = SDL_GetPerformanceCounter();
+
+	captureStage(&current);
+
+	keyframe = count == 0 || sinceKeyframe >= REWIND_KEYFRAME_INTERVAL || getState(&current)->entitiesSize != getState(&previous)->entitiesSize;
+
+	if (!keyframe)
+	{
+		encodeDelta();
+
+		makeRoom(delta.size);
+
+		/* nothing older than this frame could be kept */
+		keyframe = count == 0;
+	}
+
+	if (keyframe)
+	{
+		makeRoom(current.size);
+
+		store(&current, 1);
+
+		sinceKeyframe = 1;
+	}
+	else
+	{
+		store(&delta, 0);
+
+		sinceKeyframe++;
+	}
+
+	/* the frame just taken is what the next one is compared against */
+	swap = previous;
+	previous = current;
+	current = swap;
+
+	updateRewindStats(then);
+}
+
+/* everything a tick can change, bar the player's recording, which restoreStage winds back instead */
+void captureStage(Snapshot *s)
+{
+	RewindState state;
+	int *words, i, j, n;
+
+	takeSnapshot(s);
+
+	state.entitiesSize = s->size;
+
+	n = getNumProjectileArrays();
+
+	appendSnapshot(s, NULL, sizeof(int) * n * stage.projectiles.count);
+
+	/* a projectile's values are kept together, so that one being fired or removed only moves those after it */
+	words = (int*)(s->data + state.entitiesSize);
+
+	for (i = 0 ; i < n ; i++)
+	{
+		for (j = 0 ; j < stage.projectiles.count ; j++)
+		{
+			memcpy(&words[(j * n) + i], (char*)getProjectileArray(i) + (j * sizeof(int)), sizeof(int));
+		}
+	}
+
+	state.frame = stage.frame;
+	state.keys = stage.keys;
+	state.coins = stage.coins;
+	state.items = stage.items;
+	state.time = stage.time;
+	state.status = stage.status;
+	state.nextStageTimer = stage.nextStageTimer;
+	state.numProjectiles = stage.projectiles.count;
+
+	/* jumps, deaths and the like made after this aren't counted once it's gone back to */
+	memcpy(state.stats, game.stats, sizeof(state.stats));
+
+	appendSnapshot(s, &state, sizeof(RewindState));
+}
+
+/* a frame is entirely ints, floats and pointers, so it's compared a word at a time */
+static void encodeDelta(void)
+{
+	RewindSpan span;
+	int *from, *to, n, m, i, end, same;
+
+	from = (int*)previous.data;
+	to = (int*)current.data;
+
+	n = current.size / sizeof(int);
+
+	/* the frames can differ in length, by the projectiles, and anything past the end of the one before has changed */
+	m = previous.size / sizeof(int);
+
+	delta.size = 0;
+
+	i = 0;
+
+	while (i < n)
+	{
+		if (i < m && from[i] == to[i])
+		{
+			i++;
+
+			continue;
+		}
+
+		end = i + 1;
+		same = 0;
+
+		while (end + same < n && same <= SPAN_GAP)
+		{
+			if (end + same >= m || from[end + same] != to[end + same])
+			{
+				end += same + 1;
+				same = 0;
+			}
+			else
+			{
+				same++;
+			}
+		}
+
+		span.offset = sizeof(int) * i;
+		span.length = sizeof(int) * (end - i);
+
+		appendSnapshot(&delta, &span, sizeof(RewindSpan));
+		appendSnapshot(&delta, &to[i], span.length);
+
+		i = end;
+	}
+}
+
+static void makeRoom(int size)
+{
+	if (size > REWIND_BUFFER_SIZE)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Rewind frame too large (%d)", size);
+		exit(1);
+	}
+
+	if (count == REWIND_FRAMES)
+	{
+		dropOldest();
+	}
+
+	while (findSpace(size) == -1)
+	{
+		dropOldest();
+	}
+}
+
+/* the frames in use run from the oldest's offset to tail, wrapping around to the start when tail is below it */
+static int findSpace(int size)
+{
+	int head;
+
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	head = getFrame(0)->offset;
+
+	if (tail > head)
+	{
+		if (tail + size <= REWIND_BUFFER_SIZE)
+		{
+			return tail;
+		}
+
+		return size <= head ? 0 : -1;
+	}
+
+	return tail + size <= head ? tail : -1;
+}
+
+static void store(Snapshot *s, int keyframe)
+{
+	RewindFrame *f;
+
+	f = getFrame(count);
+	f->offset = findSpace(s->size);
+	f->size = s->size;
+	f->length = current.size;
+	f->keyframe = keyframe;
+
+	memcpy(data + f->offset, s->data, s->size);
+
+	tail = f->offset + f->size;
+
+	count++;
+}
+
+/* the frames after a keyframe can't be put back without it, so they go too */
+static void dropOldest(void)
+{
+	do
+	{
+		first = (first + 1) % REWIND_FRAMES;
+
+		count--;
+	}
+	while (count > 0 && !getFrame(0)->keyframe);
+}
+
+static RewindFrame *getFrame(int n)
+{
+	return &frames[(first + n) % REWIND_FRAMES];
+}
+
+/* steps the stage back a frame, unless there's nothing older left */
+int rewindStage(void)
+{
+	Uint64 then;
+
+	if (count < 2)
+	{
+		return 0;
+	}
+
+	then = SDL_GetPerformanceCounter();
+
+	count--;
+
+	tail = getFrame(count)->offset;
+
+	decodeFrame(count - 1);
+
+	restoreStage(&previous);
+
+	updateRewindStats(then);
+
+	return 1;
+}
+
+/* into previous, which the next frame recorded will be compared against */
+static void decodeFrame(int n)
+{
+	RewindFrame *f;
+	RewindSpan *span;
+	char *p;
+	int k;
+
+	k = n;
+
+	while (!getFrame(k)->keyframe)
+	{
+		k--;
+	}
+
+	f = getFrame(k);
+
+	previous.size = 0;
+
+	appendSnapshot(&previous, data + f->offset, f->size);
+
+	sinceKeyframe = n - k + 1;
+
+	while (++k <= n)
+	{
+		f = getFrame(k);
+
+		if (f->length > previous.size)
+		{
+			appendSnapshot(&previous, NULL, f->length - previous.size);
+		}
+
+		previous.size = f->length;
+
+		p = data + f->offset;
+
+		while (p < data + f->offset + f->size)
+		{
+			span = (RewindSpan*)p;
+			p += sizeof(RewindSpan);
+
+			memcpy(previous.data + span->offset, p, span->length);
+			p += span->length;
+		}
+	}
+}
+
+void restoreStage(Snapshot *s)
+{
+	RewindState *state;
+	int *words, i, j, n;
+
+	state = getState(s);
+
+	clearEntities();
+
+	restoreSnapshot(s);
+
+	stage.projectiles.count = state->numProjectiles;
+
+	n = getNumProjectileArrays();
+
+	words = (int*)(s->data + state->entitiesSize);
+
+	for (i = 0 ; i < n ; i++)
+	{
+		for (j = 0 ; j < state->numProjectiles ; j++)
+		{
+			memcpy((char*)getProjectileArray(i) + (j * sizeof(int)), &words[(j * n) + i], sizeof(int));
+		}
+	}
+
+	stage.frame = state->frame;
+	stage.keys = state->keys;
+	stage.coins = state->coins;
+	stage.items = state->items;
+	stage.time = state->time;
+	stage.status = state->status;
+	stage.nextStageTimer = state->nextStageTimer;
+
+	memcpy(game.stats, state->stats, sizeof(game.stats));
+
+	/* what the player did after this is forgotten, as their clones must not repeat it */
+	rewindRecording(stage.frame);
+}
+
+/* each of the projectiles' arrays holds 4 byte values */
+static void *getProjectileArray(int i)
+{
+	Projectiles *p;
+
+	p = &stage.projectiles;
+
+	switch (i)
+	{
+		case 0:
+			return p->x;
+
+		case 1:
+			return p->y;
+
+		case 2:
+			return p->dx;
+
+		case 3:
+			return p->dy;
+
+		case 4:
+			return p->gravity;
+
+		case 5:
+			return p->type;
+
+		case 6:
+			return p->facing;
+
+		case 7:
+			return p->timer;
+
+		case 8:
+			return p->alive;
+
+		default:
+			return NULL;
+	}
+}
+
+static int getNumProjectileArrays(void)
+{
+	int n;
+
+	for (n = 0 ; getProjectileArray(n) != NULL ; n++)
+	{
+	}
+
+	return n;
+}
+
+/* always the last thing in a frame */
+static RewindState *getState(Snapshot *s)
+{
+	return (RewindState*)(s->data + s->size - sizeof(RewindState));
+}
+
+static void updateRewindStats(Uint64 then)
+{
+	app.dev.rewindFrames = count;
+	app.dev.rewindCost = (SDL_GetPerformanceCounter() - then) * 1000000 / SDL_GetPerformanceFrequency();
+
+	if (count == 0)
+	{
+		app.dev.rewindBytes = 0;
+	}
+	else if (tail > getFrame(0)->offset)
+	{
+		app.dev.rewindBytes = tail - getFrame(0)->offset;
+	}
+	else
+	{
+		app.dev.rewindBytes = (REWIND_BUFFER_SIZE - getFrame(0)->offset) + tail;
+	}
+}
+
+/* for a new stage, or a new attempt at one; the memory is kept */
+void clearRewind(void)
+{
+	first = count = tail = sinceKeyframe = 0;
+
+	updateRewindStats(SDL_GetPerformanceCounter());
+}
+
+void destroyRewind(void)
+{
+	free(data);
+
+	data = NULL;
+
+	destroySnapshot(&current);
+	destroySnapshot(&previous);
+	destroySnapshot(&delta);
+}
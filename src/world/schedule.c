@@ -0,0 +1,210 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "schedule.h"
+#include "../system/util.h"
+
+#define NUM_UPDATE_CONSTRAINTS    (sizeof(updateConstraints) / sizeof(updateConstraints[0]))
+
+extern App app;
+extern Stage stage;
+
+static int addUpdateGroup(EntityDef *def);
+static int matches(char *typeName, char *pattern);
+static void sortGroups(void);
+
+/*
+ * Which kinds of entity must be updated before which others, by typeName ("*" being any
+ * other kind). Riders follow whatever they are standing on, so that must have moved first.
+ * Groups not ordered here keep the order in which they first appear in the entity list.
+ */
+static char *updateConstraints[][2] = {
+	{"platform", "*"},
+	{"pushBlock", "player"},
+	{"pushBlock", "clone"},
+	{"player", "clone"}
+};
+
+static EntityDef *groupDefs[MAX_UPDATE_GROUPS];
+static Uint64 groupAfter[MAX_UPDATE_GROUPS];
+static int numGroups;
+
+static int groupCount[MAX_UPDATE_GROUPS];
+static int present[MAX_UPDATE_GROUPS];
+static int numPresent;
+
+static Entity **order;
+static int orderCapacity;
+
+/* every entity in the stage, bucketed by def so that each tick function runs over all of its instances in a row */
+Entity **scheduleEntities(int *n)
+{
+	Entity *e;
+	int i, g, start, count, size;
+
+	memset(groupCount, 0, sizeof(groupCount));
+
+	numPresent = *n = 0;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		g = e->def->updateGroup - 1;
+
+		if (g == -1)
+		{
+			g = addUpdateGroup(e->def);
+		}
+
+		if (groupCount[g]++ == 0)
+		{
+			present[numPresent++] = g;
+		}
+
+		(*n)++;
+	}
+
+	if (*n > orderCapacity)
+	{
+		size = MAX(*n, orderCapacity * 2);
+
+		order = resize(order, sizeof(Entity*) * orderCapacity, sizeof(Entity*) * size);
+
+		orderCapacity = size;
+	}
+
+	if (app.dev.spawnOrder)
+	{
+		i = 0;
+
+		for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+		{
+			order[i++] = e;
+		}
+
+		return order;
+	}
+
+	sortGroups();
+
+	/* each group's count becomes the place its next entity goes */
+	start = 0;
+
+	for (i = 0 ; i < numPresent ; i++)
+	{
+		g = present[i];
+
+		count = groupCount[g];
+		groupCount[g] = start;
+		start += count;
+	}
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		order[groupCount[e->def->updateGroup - 1]++] = e;
+	}
+
+	return order;
+}
+
+/* a stable topological sort: the first group whose predecessors have all been placed goes next */
+static void sortGroups(void)
+{
+	Uint64 waiting;
+	int i, j, g;
+
+	waiting = 0;
+
+	for (i = 0 ; i < numPresent ; i++)
+	{
+		waiting |= 1ULL << present[i];
+	}
+
+	for (i = 0 ; i < numPresent ; i++)
+	{
+		for (j = i ; j < numPresent ; j++)
+		{
+			if ((groupAfter[present[j]] & waiting) == 0)
+			{
+				break;
+			}
+		}
+
+		if (j == numPresent)
+		{
+			SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Update constraints form a cycle around '%s'", groupDefs[present[i]]->typeName);
+			exit(1);
+		}
+
+		g = present[j];
+
+		memmove(&present[i + 1], &present[i], sizeof(int) * (j - i));
+
+		present[i] = g;
+
+		waiting &= ~(1ULL << g);
+	}
+}
+
+/* defs are given a group the first time they are scheduled, and the constraints are resolved against the groups known so far */
+static int addUpdateGroup(EntityDef *def)
+{
+	int i, g, other;
+	char *before, *after;
+
+	if (numGroups == MAX_UPDATE_GROUPS)
+	{
+		SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_CRITICAL, "Too many update groups (max %d)", MAX_UPDATE_GROUPS);
+		exit(1);
+	}
+
+	g = numGroups++;
+
+	groupDefs[g] = def;
+	groupAfter[g] = 0;
+
+	def->updateGroup = g + 1;
+
+	for (i = 0 ; i < NUM_UPDATE_CONSTRAINTS ; i++)
+	{
+		before = updateConstraints[i][0];
+		after = updateConstraints[i][1];
+
+		for (other = 0 ; other < g ; other++)
+		{
+			if (matches(def->typeName, before) && matches(groupDefs[other]->typeName, after))
+			{
+				groupAfter[other] |= 1ULL << g;
+			}
+
+			if (matches(def->typeName, after) && matches(groupDefs[other]->typeName, before))
+			{
+				groupAfter[g] |= 1ULL << other;
+			}
+		}
+	}
+
+	return g;
+}
+
+static int matches(char *typeName, char *pattern)
+{
+	return strcmp(pattern, "*") == 0 || strcmp(typeName, pattern) == 0;
+}
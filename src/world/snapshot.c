@@ -0,0 +1,281 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+#include "../common.h"
+#include "snapshot.h"
+#include "../system/util.h"
+#include "../world/entities.h"
+#include "../world/entityFactory.h"
+#include "../world/entityPool.h"
+#include "../world/quadtree.h"
+#include "../world/targets.h"
+
+extern Stage stage;
+
+static void addRecord(Snapshot *s, Entity *e, int dead);
+static void markQuadtreeOrder(Entity *e);
+static void setRecordIndex(Entity *e, int i);
+static int getRecordIndex(Entity *e);
+
+static char padding[sizeof(void*)];
+static Snapshot *ordering;
+static Entity **restored;
+static int restoredCapacity;
+static int *recordIndexes;
+static int recordIndexesCapacity;
+
+/*
+ * Copies every entity on the stage, and its data, into one block of memory, so that they can
+ * be put back later without walking the stage's JSON again, running every init and load, and
+ * dropping everything back to the floor. The player and clones that have died are included.
+ */
+void takeSnapshot(Snapshot *s)
+{
+	SnapshotHeader *header;
+	Entity *e;
+	int i, start;
+
+	s->size = 0;
+
+	i = 0;
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		setRecordIndex(e, i++);
+	}
+
+	for (e = getDeadEntities() ; e != NULL ; e = e->next)
+	{
+		setRecordIndex(e, i++);
+	}
+
+	appendSnapshot(s, NULL, sizeof(SnapshotHeader));
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		addRecord(s, e, 0);
+	}
+
+	for (e = getDeadEntities() ; e != NULL ; e = e->next)
+	{
+		addRecord(s, e, 1);
+	}
+
+	/* the order the quadtree holds entities in is the order they're found in when colliding */
+	start = s->size;
+
+	ordering = s;
+
+	forEachInQuadtree(markQuadtreeOrder);
+
+	header = (SnapshotHeader*)s->data;
+	header->numEnts = i;
+	header->numOrdered = (s->size - start) / sizeof(int);
+	header->totalKeys = stage.totalKeys;
+	header->totalItems = stage.totalItems;
+	header->totalCoins = stage.totalCoins;
+	header->entityId = getLastEntityId();
+}
+
+static void addRecord(Snapshot *s, Entity *e, int dead)
+{
+	SnapshotRecord record;
+	Entity *riding;
+	int n;
+
+	riding = getEntity(e->riding);
+
+	n = e->data != NULL ? getComponentSize(getComponentType(e->data)) : 0;
+
+	record.componentType = e->data != NULL ? getComponentType(e->data) : -1;
+	record.riding = riding != NULL ? getRecordIndex(riding) : -1;
+	record.dead = dead;
+
+	/* keeps every record aligned */
+	record.componentSize = (n + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+	appendSnapshot(s, &record, sizeof(SnapshotRecord));
+	appendSnapshot(s, e, sizeof(Entity));
+
+	if (e->data != NULL)
+	{
+		appendSnapshot(s, e->data, n);
+		appendSnapshot(s, padding, record.componentSize - n);
+	}
+}
+
+static void markQuadtreeOrder(Entity *e)
+{
+	int i;
+
+	i = getRecordIndex(e);
+
+	appendSnapshot(ordering, &i, sizeof(int));
+}
+
+/* kept by the entity's place in its pool, so that riding and the quadtree's order can refer to records */
+static void setRecordIndex(Entity *e, int i)
+{
+	int index, capacity;
+
+	index = getEntityHandle(e).index;
+
+	if (index >= recordIndexesCapacity)
+	{
+		capacity = MAX(recordIndexesCapacity * 2, index + 1);
+
+		recordIndexes = resize(recordIndexes, sizeof(int) * recordIndexesCapacity, sizeof(int) * capacity);
+
+		recordIndexesCapacity = capacity;
+	}
+
+	recordIndexes[index] = i;
+}
+
+static int getRecordIndex(Entity *e)
+{
+	return recordIndexes[getEntityHandle(e).index];
+}
+
+/* also for those that keep more alongside the entities; src can be NULL, to leave room that is filled in later */
+void appendSnapshot(Snapshot *s, void *src, int n)
+{
+	int capacity;
+
+	if (s->size + n > s->capacity)
+	{
+		capacity = MAX(s->capacity * 2, s->size + n);
+
+		s->data = resize(s->data, s->capacity, capacity);
+
+		s->capacity = capacity;
+	}
+
+	if (src != NULL)
+	{
+		memcpy(s->data + s->size, src, n);
+	}
+
+	s->size += n;
+}
+
+/* adds the entities back with the ids they had, so whatever they are replacing must already have been removed */
+void restoreSnapshot(Snapshot *s)
+{
+	SnapshotHeader *header;
+	SnapshotRecord *record;
+	Entity *e;
+	char *p;
+	int i, *order;
+
+	header = (SnapshotHeader*)s->data;
+
+	if (header->numEnts > restoredCapacity)
+	{
+		restored = resize(restored, sizeof(Entity*) * restoredCapacity, sizeof(Entity*) * header->numEnts);
+
+		restoredCapacity = header->numEnts;
+	}
+
+	p = s->data + sizeof(SnapshotHeader);
+
+	for (i = 0 ; i < header->numEnts ; i++)
+	{
+		record = (SnapshotRecord*)p;
+		p += sizeof(SnapshotRecord);
+
+		e = allocEntity();
+		memcpy(e, p, sizeof(Entity));
+		p += sizeof(Entity);
+
+		e->next = e->typePrev = e->typeNext = NULL;
+
+		if (record->componentType != -1)
+		{
+			e->data = allocComponent(record->componentType);
+			memcpy(e->data, p, getComponentSize(record->componentType));
+			p += record->componentSize;
+		}
+
+		if (e->def->type == ET_PLAYER)
+		{
+			stage.player = getEntityHandle(e);
+		}
+		else if (e->def->type == ET_PARTNER)
+		{
+			stage.partner = getEntityHandle(e);
+		}
+
+		if (record->dead)
+		{
+			addDeadEntity(e);
+		}
+		else
+		{
+			linkEntity(e);
+		}
+
+		restored[i] = e;
+	}
+
+	order = (int*)p;
+
+	p = s->data + sizeof(SnapshotHeader);
+
+	for (i = 0 ; i < header->numEnts ; i++)
+	{
+		record = (SnapshotRecord*)p;
+		p += sizeof(SnapshotRecord) + sizeof(Entity) + record->componentSize;
+
+		restored[i]->riding = getEntityHandle(record->riding != -1 ? restored[record->riding] : NULL);
+	}
+
+	for (i = 0 ; i < header->numOrdered ; i++)
+	{
+		addToQuadtree(restored[order[i]], &stage.quadtree);
+	}
+
+	/* the names the switches interned when the stage loaded are kept */
+	indexTargets();
+
+	stage.totalKeys = header->totalKeys;
+	stage.totalItems = header->totalItems;
+	stage.totalCoins = header->totalCoins;
+
+	setLastEntityId(header->entityId);
+}
+
+void destroySnapshot(Snapshot *s)
+{
+	free(s->data);
+
+	memset(s, 0, sizeof(Snapshot));
+
+	free(restored);
+
+	restored = NULL;
+
+	restoredCapacity = 0;
+
+	free(recordIndexes);
+
+	recordIndexes = NULL;
+
+	recordIndexesCapacity = 0;
+}
@@ -41,6 +41,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "../world/entities.h"
 #include "../system/draw.h"
 #include "../world/map.h"
+#include "../world/entityPool.h"
+#include "../world/recording.h"
+#include "../world/snapshot.h"
+#include "../world/rewind.h"
+#include "../world/prediction.h"
+#include "../game/replay.h"
+#include "../game/netplay.h"
+#include "../entities/partner.h"
 
 #define SHOW_GAME    0
 #define SHOW_MENU    1
@@ -63,6 +71,9 @@ static void initBackgroundData(void);
 static void doTips(void);
 static void drawTips(void);
 static void doGame(void);
+static void doTick(void);
+static void doFastForward(void);
+static int canFastForward(void);
 static void doMenu(void);
 static void drawGame(void);
 static void drawMenu(void);
@@ -75,7 +86,9 @@ static void updateStageProgress(void);
 static SDL_Color getColorForItems(int current, int total);
 
 static cJSON *stageJSON;
+static Snapshot initialState;
 static int cloneWarning;
+static float fastForwardSpeed;
 static int showTips;
 static int tipIndex;
 static int numTips;
@@ -99,7 +112,8 @@ void initStage(void)
 
 	stage.entityTail = &stage.entityHead;
 	stage.particleTail = &stage.particleHead;
-	stage.cloneDataTail = &stage.cloneDataHead;
+
+	startRecording();
 
 	resumeWidget = getWidget("resume", "stage");
 	resumeWidget->action = resume;
@@ -122,9 +136,12 @@ void initStage(void)
 
 	tipsPrompt = getAtlasImage("gfx/main/tips.png", 1);
 
-	game.stats[STAT_STAGES_STARTED]++;
+	if (!app.headless)
+	{
+		game.stats[STAT_STAGES_STARTED]++;
 
-	saveGame();
+		saveGame();
+	}
 
 	initWipe(WIPE_IN);
 
@@ -137,7 +154,15 @@ void loadStage(int randomTiles)
 	char *json;
 	char filename[MAX_FILENAME_LENGTH];
 
-	srand(256 * stage.num);
+	/* a replay sets its own */
+	if (stage.seed == 0)
+	{
+		stage.seed = 256 * stage.num;
+	}
+
+	srand(stage.seed);
+
+	startReplayRecording();
 
 	sprintf(filename, "data/stages/%03d.json", stage.num);
 
@@ -158,15 +183,27 @@ void loadStage(int randomTiles)
 
 	initQuadtree(&stage.quadtree);
 
-	initEntities(root);
+	initEntities(root, json);
 
 	initTips(root);
 
+	/* the editor needs to keep everything as entities */
 	if (randomTiles)
 	{
 		randomizeTiles();
 
 		dropToFloor();
+
+		if (app.netplay.active)
+		{
+			initPartner();
+
+			resetNetplay();
+		}
+
+		bakeEntities();
+
+		takeSnapshot(&initialState);
 	}
 
 	free(json);
@@ -204,52 +241,140 @@ static void doGame(void)
 {
 	if (!showTips)
 	{
-		doControls();
+		if (app.netplay.active)
+		{
+			if (doNetplay(doTick))
+			{
+				nextStage(stage.num);
+			}
+		}
+		else if (canFastForward() && isControl(CONTROL_FAST_FORWARD))
+		{
+			doFastForward();
+		}
+		else
+		{
+			fastForwardSpeed = 0;
+
+			doTick();
+		}
+
+		doPrediction();
+	}
+	else
+	{
+		doTips();
+	}
+}
+
+/* runs as many ticks as fit in what's left of the frame, up to FAST_FORWARD_MAX_TICKS. Only
+ * the first makes particles and positional sounds; the rest are never seen or heard */
+static void doFastForward(void)
+{
+	Uint64 start, elapsed, budget;
+	int ticks;
+
+	start = SDL_GetPerformanceCounter();
+
+	budget = SDL_GetPerformanceFrequency() * FAST_FORWARD_BUDGET / 1000;
+
+	ticks = 0;
+
+	do
+	{
+		stage.skipEffects = ticks > 0;
 
-		doEntities();
+		doTick();
+
+		ticks++;
+
+		elapsed = SDL_GetPerformanceCounter() - start;
+	}
+	while (ticks < FAST_FORWARD_MAX_TICKS && elapsed + (elapsed / ticks) < budget && canFastForward());
+
+	stage.skipEffects = 0;
+
+	if (fastForwardSpeed == 0)
+	{
+		fastForwardSpeed = ticks;
+	}
+
+	/* smoothed, so that the HUD doesn't flicker between two numbers */
+	fastForwardSpeed += (ticks - fastForwardSpeed) * 0.1;
+}
+
+/* stops at anything that would have held up the next tick, such as the menu or a wipe */
+static int canFastForward(void)
+{
+	return show == SHOW_GAME && !showTips && stage.status == SS_INCOMPLETE && !isWiping();
+}
+
+static void doTick(void)
+{
+	doReplay();
+
+	if (stage.status != SS_COMPLETE && isControl(CONTROL_REWIND))
+	{
+		rewindStage();
 
 		doParticles();
 
-		stage.frame++;
+		return;
+	}
 
-		if (stage.status == SS_COMPLETE)
-		{
-			stage.nextStageTimer--;
+	doControls();
 
-			if (stage.nextStageTimer == 0)
-			{
-				initWipe(WIPE_OUT);
+	doEntities();
 
-				playSound(SND_WIPE, CH_PLAYER);
-			}
-			else if (stage.nextStageTimer < 0)
-			{
-				updateStageProgress();
+	doParticles();
 
-				nextStage(stage.num + 1);
-			}
-		}
+	stage.frame++;
+
+	if (stage.status == SS_COMPLETE)
+	{
+		stage.nextStageTimer--;
 
-		if (stage.reset)
+		if (stage.nextStageTimer == 0)
 		{
-			resetStage();
+			initWipe(WIPE_OUT);
 
-			initWipe(WIPE_FADE);
+			playSound(SND_WIPE, CH_PLAYER);
 		}
-
-		if (stage.status == SS_INCOMPLETE && stage.time > 0)
+		else if (stage.nextStageTimer < 0)
 		{
-			doTimeLimit();
+			updateStageProgress();
+
+			nextStage(stage.num + 1);
 		}
+	}
 
-		cloneWarning = MAX(cloneWarning - 1, 0);
+	if (stage.reset)
+	{
+		resetStage();
+
+		initWipe(WIPE_FADE);
 	}
-	else
+
+	if (stage.status == SS_INCOMPLETE && stage.time > 0)
 	{
-		doTips();
+		doTimeLimit();
+	}
+
+	cloneWarning = MAX(cloneWarning - 1, 0);
+
+	/* co-op keeps its own history, and can't be rewound, and nor can anything that's only being tried out */
+	if (stage.status != SS_COMPLETE && !app.netplay.active && !stage.predicting)
+	{
+		recordRewind();
 	}
 }
 
+/* a single frame of play, without the wipes and menus around it, for tools that drive the stage themselves */
+void tickStage(void)
+{
+	doTick();
+}
+
 static void updateStageProgress(void)
 {
 	StageMeta *meta;
@@ -338,6 +463,12 @@ static void doControls(void)
 
 			playSound(SND_TIP, CH_PLAYER);
 		}
+		else if (app.keyboard[SDL_SCANCODE_F2])
+		{
+			app.keyboard[SDL_SCANCODE_F2] = 0;
+
+			togglePrediction();
+		}
 	}
 
 	if (stage.status != SS_COMPLETE && isControl(CONTROL_RESTART))
@@ -398,17 +529,20 @@ static void resetStage(void)
 
 	stage.coins = stage.totalCoins = 0;
 
-	srand(256 * stage.num);
+	srand(stage.seed);
 
 	resetCloneData();
 
 	resetEntities();
 
-	initEntities(stageJSON);
-
-	dropToFloor();
+	restoreSnapshot(&initialState);
 
 	resetClones();
+
+	/* the clones' recordings can't be taken back, so neither can anything before them */
+	clearRewind();
+
+	clearPrediction();
 }
 
 static void draw(void)
@@ -441,6 +575,8 @@ static void drawGame()
 
 	drawEntities(0);
 
+	drawPrediction();
+
 	drawParticles();
 
 	drawHud();
@@ -559,6 +695,16 @@ static void drawHud(void)
 		drawText(SCREEN_WIDTH - 10, 0, 32, TEXT_RIGHT, app.colors.red, "Time: %02d:%02d", m, s);
 	}
 
+	if (app.netplay.waiting)
+	{
+		drawText(SCREEN_WIDTH - 10, 30, 32, TEXT_RIGHT, app.colors.yellow, "Waiting for partner ...");
+	}
+
+	if (fastForwardSpeed > 0)
+	{
+		drawText(SCREEN_WIDTH - 10, 30, 32, TEXT_RIGHT, app.colors.yellow, "Fast Forward: x%.1f", fastForwardSpeed);
+	}
+
 	if (stage.status == SS_FAILED)
 	{
 		drawRect(0, SCREEN_HEIGHT - 30, SCREEN_WIDTH, 30, 0, 0, 0, 192);
@@ -599,37 +745,35 @@ static void initTips(cJSON *root)
 		numTips++;
 	}
 
-	showTips = numTips > 0 && app.config.tips;
+	showTips = numTips > 0 && app.config.tips && !app.replay.playing && !app.netplay.active;
 }
 
 static void resetCloneData(void)
 {
 	stage.frame = 0;
 
-	stage.cloneDataTail = &stage.cloneDataHead;
-}
-
-static void destroyCloneData(void)
-{
-	CloneData *cd;
-
-	while (stage.cloneDataHead.next)
-	{
-		cd = stage.cloneDataHead.next;
-		stage.cloneDataHead.next = cd->next;
-		free(cd);
-	}
+	startRecording();
 }
 
 void destroyStage(void)
 {
+	endReplay();
+
 	destroyQuadtree();
 
 	destroyEntities();
 
 	destroyParticles();
 
-	destroyCloneData();
+	destroyRecordings();
+
+	destroySnapshot(&initialState);
+
+	clearRewind();
+
+	clearPrediction();
+
+	resetEntityPools();
 
 	cJSON_Delete(stageJSON);
 }
@@ -687,7 +831,15 @@ static void restart(void)
 {
 	show = SHOW_GAME;
 
-	nextStage(stage.num);
+	/* the other player has to restart at the same moment */
+	if (app.netplay.active)
+	{
+		requestNetplayRestart();
+	}
+	else
+	{
+		nextStage(stage.num);
+	}
 }
 
 static void returnFrom(void)
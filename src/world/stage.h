@@ -19,5 +19,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 void destroyStage(void);
+void tickStage(void);
 void loadStage(int randomTiles);
 void initStage(void);
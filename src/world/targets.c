@@ -0,0 +1,164 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "../common.h"
+#include "targets.h"
+#include "../system/util.h"
+#include "../world/entityPool.h"
+
+#define INITIAL_TARGET_CAPACITY    16
+
+extern Stage stage;
+
+static void addTargetEntity(Target *t, Entity *e);
+static int findTarget(char *name);
+
+static Target *targets;
+static int numTargets;
+static int targetCapacity;
+
+/* keeps the entity lists' memory for the next stage */
+void clearTargets(void)
+{
+	int i;
+
+	for (i = 0 ; i < numTargets ; i++)
+	{
+		targets[i].numEnts = 0;
+	}
+
+	numTargets = 0;
+}
+
+/* called by switches as they load, so they hold an index rather than a name to look up */
+int internTarget(char *name)
+{
+	int i, n;
+
+	i = findTarget(name);
+
+	if (i == -1)
+	{
+		if (numTargets == targetCapacity)
+		{
+			n = MAX(targetCapacity * 2, INITIAL_TARGET_CAPACITY);
+
+			targets = resize(targets, sizeof(Target) * targetCapacity, sizeof(Target) * n);
+			targetCapacity = n;
+		}
+
+		i = numTargets++;
+
+		STRNCPY(targets[i].name, name, MAX_NAME_LENGTH);
+		targets[i].numEnts = 0;
+	}
+
+	return i;
+}
+
+Target *getTarget(int target)
+{
+	return &targets[target];
+}
+
+/* gathers everything that can be activated under each name, in update order, replacing what was gathered before */
+void indexTargets(void)
+{
+	Entity *e;
+	int i;
+
+	for (i = 0 ; i < numTargets ; i++)
+	{
+		targets[i].numEnts = 0;
+	}
+
+	for (e = stage.entityHead.next ; e != NULL ; e = e->next)
+	{
+		if (e->def->activate)
+		{
+			i = findTarget(e->name);
+
+			if (i != -1)
+			{
+				addTargetEntity(&targets[i], e);
+			}
+		}
+	}
+}
+
+/* once, when the stage loads, as the targets are indexed again every time the stage is restored */
+void reportMissingTargets(void)
+{
+	int i;
+
+	for (i = 0 ; i < numTargets ; i++)
+	{
+		if (targets[i].numEnts == 0)
+		{
+			SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN, "Stage %d: nothing named '%s' can be activated", stage.num, targets[i].name);
+		}
+	}
+}
+
+static void addTargetEntity(Target *t, Entity *e)
+{
+	int n;
+
+	if (t->numEnts == t->capacity)
+	{
+		n = MAX(t->capacity * 2, INITIAL_TARGET_CAPACITY);
+
+		t->ents = resize(t->ents, sizeof(EntityHandle) * t->capacity, sizeof(EntityHandle) * n);
+		t->capacity = n;
+	}
+
+	t->ents[t->numEnts++] = getEntityHandle(e);
+}
+
+static int findTarget(char *name)
+{
+	int i;
+
+	for (i = 0 ; i < numTargets ; i++)
+	{
+		if (strcmp(targets[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void destroyTargets(void)
+{
+	int i;
+
+	for (i = 0 ; i < targetCapacity ; i++)
+	{
+		free(targets[i].ents);
+	}
+
+	free(targets);
+
+	targets = NULL;
+	numTargets = targetCapacity = 0;
+}
+
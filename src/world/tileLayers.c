@@ -0,0 +1,235 @@
+/*
+Copyright (C) 2019,2022 Parallel Realities
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+#include "../common.h"
+#include "tileLayers.h"
+#include "../system/draw.h"
+#include "../system/util.h"
+
+extern App app;
+extern Stage stage;
+
+static int getCell(int x, int y);
+static void getCellRange(TileLayer *l, int x, int y, int w, int h, int *x1, int *y1, int *x2, int *y2);
+static void indexLayer(TileLayer *l);
+
+static TileLayer layers[TL_MAX];
+static TileSprite *scratch;
+static int scratchCapacity;
+static int cursors[MAP_WIDTH * MAP_HEIGHT];
+
+/*
+ * Decorations and spikes never move or change, so when a stage is played they are taken
+ * out of the entity list and kept here instead, sorted by tile like the map itself. They
+ * are drawn with the map and the spikes are checked as Walter moves, rather than each one
+ * being ticked, kept in the quadtree and drawn as an entity.
+ */
+void addTileSprite(int layer, AtlasImage *atlasImage, int x, int y, int flip)
+{
+	TileLayer *l;
+	TileSprite *s;
+
+	l = &layers[layer];
+
+	if (l->numSprites == l->capacity)
+	{
+		l->sprites = resize(l->sprites, sizeof(TileSprite) * l->capacity, sizeof(TileSprite) * MAX(l->capacity * 2, 64));
+
+		l->capacity = MAX(l->capacity * 2, 64);
+	}
+
+	s = &l->sprites[l->numSprites++];
+
+	s->atlasImage = atlasImage;
+	s->x = x;
+	s->y = y;
+	s->flip = flip;
+
+	l->maxW = MAX(l->maxW, atlasImage->rect.w);
+	l->maxH = MAX(l->maxH, atlasImage->rect.h);
+}
+
+void indexTileLayers(void)
+{
+	int i;
+
+	for (i = TL_DECORATION ; i < TL_MAX ; i++)
+	{
+		indexLayer(&layers[i]);
+	}
+}
+
+/* a counting sort on the tile each sprite starts in */
+static void indexLayer(TileLayer *l)
+{
+	TileSprite *s;
+	int i, c;
+
+	memset(l->cells, 0, sizeof(l->cells));
+
+	for (i = 0 ; i < l->numSprites ; i++)
+	{
+		l->cells[getCell(l->sprites[i].x, l->sprites[i].y) + 1]++;
+	}
+
+	for (c = 0 ; c < MAP_WIDTH * MAP_HEIGHT ; c++)
+	{
+		l->cells[c + 1] += l->cells[c];
+	}
+
+	if (l->numSprites > scratchCapacity)
+	{
+		scratch = resize(scratch, sizeof(TileSprite) * scratchCapacity, sizeof(TileSprite) * l->capacity);
+
+		scratchCapacity = l->capacity;
+	}
+
+	memcpy(cursors, l->cells, sizeof(cursors));
+
+	for (i = 0 ; i < l->numSprites ; i++)
+	{
+		s = &l->sprites[i];
+
+		scratch[cursors[getCell(s->x, s->y)]++] = *s;
+	}
+
+	memcpy(l->sprites, scratch, sizeof(TileSprite) * l->numSprites);
+}
+
+void drawTileLayers(void)
+{
+	TileLayer *l;
+	TileSprite *s;
+	int i, j, mx, my, x1, y1, x2, y2;
+
+	for (i = TL_DECORATION ; i < TL_MAX ; i++)
+	{
+		l = &layers[i];
+
+		if (l->numSprites == 0)
+		{
+			continue;
+		}
+
+		getCellRange(l, stage.camera.x, stage.camera.y, SCREEN_WIDTH, SCREEN_HEIGHT, &x1, &y1, &x2, &y2);
+
+		for (mx = x1 ; mx <= x2 ; mx++)
+		{
+			for (my = y1 ; my <= y2 ; my++)
+			{
+				for (j = l->cells[mx * MAP_HEIGHT + my] ; j < l->cells[mx * MAP_HEIGHT + my + 1] ; j++)
+				{
+					s = &l->sprites[j];
+
+					app.dev.drawing++;
+
+					blitAtlasImage(s->atlasImage, s->x - stage.camera.x, s->y - stage.camera.y, 0, s->flip ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+				}
+			}
+		}
+	}
+}
+
+/* spikes only hurt if they're landed on (or jumped into) all the way to their base, as they look better that way */
+int touchingHazard(int x, int y, int w, int h)
+{
+	TileLayer *l;
+	TileSprite *s;
+	int i, mx, my, x1, y1, x2, y2;
+
+	l = &layers[TL_HAZARD];
+
+	if (l->numSprites == 0)
+	{
+		return 0;
+	}
+
+	getCellRange(l, x, y, w, h, &x1, &y1, &x2, &y2);
+
+	for (mx = x1 ; mx <= x2 ; mx++)
+	{
+		for (my = y1 ; my <= y2 ; my++)
+		{
+			for (i = l->cells[mx * MAP_HEIGHT + my] ; i < l->cells[mx * MAP_HEIGHT + my + 1] ; i++)
+			{
+				s = &l->sprites[i];
+
+				if (y + h >= s->y + s->atlasImage->rect.h && collision(x, y, w, h, s->x, s->y, s->atlasImage->rect.w, s->atlasImage->rect.h))
+				{
+					return 1;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* anything outside of the map is kept in the nearest tile along the edge */
+static int getCell(int x, int y)
+{
+	int mx, my;
+
+	mx = MIN(MAX(x / TILE_SIZE, 0), MAP_WIDTH - 1);
+	my = MIN(MAX(y / TILE_SIZE, 0), MAP_HEIGHT - 1);
+
+	return (mx * MAP_HEIGHT) + my;
+}
+
+/* the tiles that sprites overlapping the area could start in */
+static void getCellRange(TileLayer *l, int x, int y, int w, int h, int *x1, int *y1, int *x2, int *y2)
+{
+	*x1 = MIN(MAX((x - l->maxW) / TILE_SIZE, 0), MAP_WIDTH - 1);
+	*y1 = MIN(MAX((y - l->maxH) / TILE_SIZE, 0), MAP_HEIGHT - 1);
+	*x2 = MIN(MAX((x + w) / TILE_SIZE, 0), MAP_WIDTH - 1);
+	*y2 = MIN(MAX((y + h) / TILE_SIZE, 0), MAP_HEIGHT - 1);
+}
+
+void clearTileLayers(void)
+{
+	int i;
+
+	for (i = TL_DECORATION ; i < TL_MAX ; i++)
+	{
+		layers[i].numSprites = 0;
+		layers[i].maxW = layers[i].maxH = 0;
+
+		memset(layers[i].cells, 0, sizeof(layers[i].cells));
+	}
+}
+
+void destroyTileLayers(void)
+{
+	int i;
+
+	for (i = TL_DECORATION ; i < TL_MAX ; i++)
+	{
+		free(layers[i].sprites);
+
+		layers[i].sprites = NULL;
+		layers[i].capacity = 0;
+	}
+
+	free(scratch);
+
+	scratch = NULL;
+	scratchCapacity = 0;
+
+	clearTileLayers();
+}